@@ -0,0 +1,66 @@
+#include "ATCommandBuilder.h"
+
+static void appendATChar(ATCommand *command, char value);
+
+
+ATCommand createATCommand(char *buffer, uint16_t capacity, const char *command) {
+    ATCommand atCommand = {.buffer = buffer, .length = 0, .capacity = capacity, .isOverflow = (buffer == NULL || capacity == 0)};
+    appendATLiteral(&atCommand, command);
+    return atCommand;
+}
+
+void appendATLiteral(ATCommand *command, const char *literal) {
+    for (uint16_t i = 0; literal[i] != '\0'; i++) {
+        appendATChar(command, literal[i]);
+    }
+}
+
+void appendATQuotedString(ATCommand *command, const char *value) {
+    appendATChar(command, '"');
+    for (uint16_t i = 0; value[i] != '\0'; i++) {
+        if (value[i] == '"' || value[i] == ',' || value[i] == '\\') {
+            appendATChar(command, '\\');
+        }
+        appendATChar(command, value[i]);
+    }
+    appendATChar(command, '"');
+}
+
+void appendATUnsigned(ATCommand *command, uint32_t value) {
+    char digits[UNSIGNED_DECIMAL_MAX_LENGTH + 1];
+    uint8_t length = formatUnsignedDecimal(digits, value);
+    for (uint8_t i = 0; i < length; i++) {
+        appendATChar(command, digits[i]);
+    }
+}
+
+bool finishATCommand(ATCommand *command) {
+    appendATLiteral(command, AT_COMMAND_END);
+    if (!command->isOverflow) {
+        command->buffer[command->length] = '\0';
+    }
+    return !command->isOverflow;
+}
+
+uint8_t formatUnsignedDecimal(char *buffer, uint32_t value) {
+    char reversed[UNSIGNED_DECIMAL_MAX_LENGTH];
+    uint8_t length = 0;
+    do {
+        reversed[length++] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    for (uint8_t i = 0; i < length; i++) {
+        buffer[i] = reversed[length - 1 - i];
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+static void appendATChar(ATCommand *command, char value) {
+    if (command->isOverflow || command->length + 1 >= command->capacity) {  // keep space for null terminator
+        command->isOverflow = true;
+        return;
+    }
+    command->buffer[command->length++] = value;
+}
@@ -1,19 +1,30 @@
 #include "ESP8266Server.h"
 
-#define COMMAND_MAX_LENGTH 100
+// join: "AT+CWJAP_CUR=" + escaped quoted ssid and password(2 * max each) + ,"<bssid>" + CRLF + null terminator
+#define COMMAND_MAX_LENGTH (13 + 2 * ESP8266_MAX_SSID_LENGTH + 1 + 2 * ESP8266_MAX_PASSWORD_LENGTH + 1 + ESP8266_BSSID_LENGTH + 2 + 3)
 #define TMP_TX_BUFFER_MAX_LENGTH 100
 
 #define DATA_RECEIVED_STATUS  "+IPD,"
-#define SEND_OK_STATUS        "\r\nSEND OK\r\n"
-#define SEND_FAIL_STATUS      "\r\nSEND FAIL\r\n"
-#define OK_STATUS             "\r\nOK\r\n"
-#define CLOSED_STATUS         "CLOSED\r\n"
-#define ERROR_STATUS          "\r\nERROR\r\n"
-#define FAIL_STATUS           "\r\nFAIL\r\n"
+#define DATA_MARKER_NAME      "IPD,"      // "+IPD," or blanked " IPD," of handled one
+#define DATA_PULLED_STATUS    "+CIPRECVDATA,"
+#define LINK_CLOSED_STATUS    ",CLOSED\r\n"
+#define WIFI_EVENT_STATUS     "WIFI "
+#define WIFI_DISCONNECT_EVENT "DISCONNECT\r\n"
+#define WIFI_GOT_IP_EVENT     "GOT IP\r\n"
+#define MODULE_READY_STATUS   "ready\r\n"       // module restarted
+#define JOINED_AP_STATUS      "+CWJAP_CUR:"
+#define STATION_STATUS        "STATUS:"
+#define REQUEST_END_MARKER    "\r\n\r\n"
+#define CONTINUE_RESPONSE     "HTTP/1.1 100 Continue\r\n\r\n"
 #define NEW_LINE              "\r\n"
-#define READY_TO_RECEIVE_DATA ">"
 
-#define ESP8266_ADDITIONAL_HEADER_LENGTH 100
+#define ESP8266_CHUNK_SIZE_DIGITS 3  // enough for 2048 byte segment
+#define ESP8266_CHUNK_SIZE_FIELD_LENGTH (ESP8266_CHUNK_SIZE_DIGITS + 2)
+#define ESP8266_CHUNK_END_LENGTH 2
+#define ESP8266_CHUNK_FRAMING_LENGTH (ESP8266_CHUNK_SIZE_FIELD_LENGTH + ESP8266_CHUNK_END_LENGTH)
+#define ESP8266_LAST_CHUNK "0\r\n\r\n"
+#define ESP8266_LAST_CHUNK_LENGTH 5
+
 #define ESP8266_STATION_AND_AP 3
 #define ESP8266_SHOW_REQUEST_IP_AND_PORT 1
 #define ESP8266_DISABLE_AUTO_CONNECT_TO_AP 0
@@ -28,7 +39,19 @@
 #define ESP8266_DATA_MARKER_MAX_LENGTH 100
 #define ESP8266_REQUEST_END_MARKER_LENGTH 4
 #define ESP8266_IPD_MARKER_REQUEST_ID_INDEX 5
+#define ESP8266_IPD_MARKER_LENGTH_INDEX 7
 #define ESP8266_ALL_CONNECTIONS_ID 5
+#define ESP8266_UDP_MODE_REMOTE_CHANGEABLE 2    // reply to the last datagram sender
+#define ESP8266_PASSIVE_RECEIVE_MODE 1
+#define ESP8266_STATION_NOT_CONNECTED 5     // AT+CIPSTATUS, "STATUS:5"
+#define ESP8266_NO_DEADLINE UINT32_MAX
+#define SYSTICK_HCLK_DIVIDER 8  // SysTick clock when CLKSOURCE bit is cleared
+#define ESP8266_PULL_RESPONSE_RESERVE 64    // command echo, "+CIPRECVDATA,<len>:" prefix, trailing OK and close notifications
+#define RETRY_AFTER_SECONDS "1"
+#define INDEXED_METHOD_COUNT 3
+#define RATE_LIMIT_TOKEN_SCALE 1000     // bucket keeps thousandths of request, refilled every millisecond
+#define TEMPLATE_PADDING "                                "
+#define TEMPLATE_PADDING_LENGTH (sizeof(TEMPLATE_PADDING) - 1)
 
 static USART *USARTInstance = NULL;
 static HTTPParser *httpParser = NULL;
@@ -36,21 +59,126 @@ static HTTPParser *httpParser = NULL;
 static StringRingBuffer *tmpTxBuffer = NULL;
 static char commandBuffer[COMMAND_MAX_LENGTH];
 
-static ESP8266ServerStatus sendATCommand(ServerContext *context, const char *ATCommandPattern, ...);
-static ESP8266ServerStatus readCommandResponse(ServerContext *context, char *rxBufferPointer);
+static ESP8266Link linkTable[ESP8266_MAX_LINK_COUNT] = {0};
+
+static RouteTable *routeTable = NULL;
+static RouteMatch routeMatch;
+
+static bool isLazyRequestParsing = false;
+static const struct IndexedMethod {
+    const char *name;
+    HTTPMethod method;
+} INDEXED_METHODS[INDEXED_METHOD_COUNT] = {{"GET", HTTP_GET}, {"POST", HTTP_POST}, {"PUT", HTTP_PUT}};  // other methods go through HTTP parser
+static RequestIndex requestIndex;
+static char *currentRequestPointer = NULL;
+static char *currentSegmentEnd = NULL;  // end of +IPD payload holding current request
+
+static bool isPassiveReceiveMode = false;
+static uint32_t idleRxLength = 0;   // rx data inspected without progress, core can sleep until more arrives
+
+static char stationSsid[ESP8266_MAX_SSID_LENGTH] = {0};  // copies kept for reconnect
+static char stationPassword[ESP8266_MAX_PASSWORD_LENGTH] = {0};
+static ESP8266LinkHealth linkHealth = {0};
+static uint32_t lastLinkCheckMs = 0;
+static bool isLinkCheckDue = false;     // station event received, check without waiting for period
+static uint8_t nextPullLinkId = 0;  // round robin between links with pending data
+static bool isPullDeferred = false;  // pulled data is not processed yet, other links wait for it
+
+static uint8_t admissionBacklogLimit = 0;
+static bool isOverloadCloseEnabled = false;  // over backlog limit links are closed without 503
+static uint8_t rateLimitPerSecond = 0;
+static uint8_t rateLimitBurstSize = 0;
+static RouteMatch pendingRouteMatch;    // used for priority lookup of queued requests, keeps routeMatch of served one intact
+static struct PendingRequest {  // oldest queued request of each link, route is looked up once when header is complete
+    const char *ipdPointer;
+    RoutePriority priority;
+    bool isReorderable;
+} pendingRequests[ESP8266_MAX_LINK_COUNT] = {0};
+
+static struct ClientBucket {
+    IPAddress address;
+    uint32_t tokens;
+    uint32_t lastRefillMs;
+} clientBuckets[ESP8266_RATE_LIMIT_CLIENT_COUNT] = {0};
+
+static struct ResponseSegmenter {   // packs response into CIPSEND segments of ESP8266_INNER_TX_BUFFER_SIZE
+    uint32_t linkId;
+    uint32_t length;
+    uint32_t chunkStart;
+    char *commandResponsePointer;
+    ESP8266ServerStatus status;
+    bool isActive;  // between begin and end, TX buffer holds pending segment
+    bool isChunked;
+    bool isChunkOpen;
+    bool isConnectionClose;
+} responseSegmenter = {0};
+
+static ESP8266ServerStatus sendATCommand(ServerContext *context, ATCommand *command);
+static ESP8266ServerStatus sendATCommandAttempts(ServerContext *context, ATCommand *command, uint8_t attemptCount);
+static ESP8266ServerStatus sendLinkATCommand(ServerContext *context, ATCommand *command);
+static ESP8266ServerStatus sendBasicATCommand(ServerContext *context, const char *command);
+static ESP8266ServerStatus sendNumericATCommand(ServerContext *context, const char *command, uint32_t value);
+static ESP8266ServerStatus readCommandResponse(ServerContext *context, char *rxBufferPointer, uint8_t successMask);
+static void waitForReceivedData(ServerContext *context, const char *receivedDataEnd, uint32_t startTimeMillis);
 
-static inline bool isResponseOK(char *responseBody);
-static inline bool isResponseError(char *responseBody);
 static inline bool isSsidValid(char *ssid);
 static inline bool isPasswordValid(char *password);
 
+static void processHttpRequest(ServerContext *context, uint8_t linkId, char *ipdMarker, char *requestStartPointer);
+static void processDatagram(ServerContext *context, uint8_t linkId, char *ipdMarker, char *payloadPointer);
+static void processWebSocketFrames(ServerContext *context, uint8_t linkId, char *ipdMarker, char *payloadPointer);
+static void handleWebSocketUpgrade(ServerContext *context, HTTPParser *request);
+static void handleStreamedRequestBody(ServerContext *context, HTTPParser *request);
+static void processRequestBody(ServerContext *context, uint8_t linkId, char *ipdMarker, char *payloadPointer);
+static void consumeRequestBody(ServerContext *context, uint8_t linkId, const char *data, uint32_t length);
+static void abortRequestBody(ServerContext *context, uint8_t linkId, RequestBodyAbortReason reason);
+static void closeWebSocketLink(ServerContext *context, uint8_t linkId, bool isConnectionClosed);
+static void detectClosedLinks(ServerContext *context);
+static char *findNotificationLine(char *searchStart, const char *notification, uint8_t linkIdLength);
+static char *findDataMarker(char *searchStart);
+static char *skipReceivedData(char *ipdPointer);
+static void releaseProcessedRequest(ServerContext *context, bool isForced);
+static bool releaseHandledNotifications(ServerContext *context);
+static char *selectPendingRequest(char *firstIpdPointer, uint8_t *backlogCount);
+static bool isRequestHeaderReceived(char *ipdPointer, const char *ipdMarker);
+static void classifyPendingRequest(struct PendingRequest *pending, const char *request);
+static bool isRequestAdmitted(ServerContext *context, uint8_t backlogCount);
+static bool takeClientToken(const IPAddress *address);
+static void rejectRequest(ServerContext *context, uint8_t backlogCount);
+static void pullPendingLinkData(ServerContext *context);
+static void startListeningESP8266(ServerContext *context);
+static void superviseStationLink(ServerContext *context);
+static void detectStationEvents(ServerContext *context);
+static bool isStationConnected(ServerContext *context);
+static void reconnectStation(ServerContext *context);
+static void restoreStationLink(ServerContext *context);
+static void cacheJoinedAccessPoint(ServerContext *context);
+static void markLinkLost();
+static void markLinkRestored();
+static void collectReceiveNotifications();
+static char *pullReceivedData(ServerContext *context, uint8_t linkId, uint32_t length);
+static void extendPulledRequest(ServerContext *context, char *ipdPointer);
+static bool joinPulledSegment(char *ipdPointer, const char *ipdMarker, char *nextIpdPointer);
+static void rejectOversizedRequest(ServerContext *context, uint8_t linkId, char *ipdPointer);
+static void dropPulledRequest(uint8_t linkId);
+static char *getCommandResponsePointer();
+static RequestHandlerFunction resolveRequestHandler(ServerContext *context);
+static RequestHandlerFunction resolveIndexedRequestHandler();
+static bool isChunkedResponseAccepted();
+static const char *copyMapValue(HashMap map, const char *name, char *valueBuffer, uint32_t bufferSize);
 static void getIPDMarkerValue(char *rawRequest, char *valueBuffer);
 static IPAddress parseRequestIPAddress(char *requestPointer);
 
-static ESP8266ServerStatus sendSingleResponse(ServerContext *context, HashMap headers, const char *body, uint32_t bodyLength, char *commandResponsePointer);
-static ESP8266ServerStatus sendChunkedResponse(ServerContext *context, HashMap headers, const char *body, uint32_t bodyLength, char *commandResponsePointer);
-static ESP8266ServerStatus sendHTTPResponseESP8266(ServerContext *context, uint32_t dataLength, char *commandResponsePointer);
+static void flushResponseSegment(ServerContext *context);
+static void flushActiveResponse(ServerContext *context);
+static void closeResponseChunk(char *txBuffer);
+static ESP8266ServerStatus writeTemplateSlot(ServerContext *context, const TemplateSegment *segment, const char *value);
+static ESP8266ServerStatus sendTxBufferESP8266(ServerContext *context, uint32_t linkId, uint32_t dataLength, char *commandResponsePointer);
+static ESP8266ServerStatus sendHTTPResponseESP8266(ServerContext *context, uint32_t linkId, uint32_t dataLength, char *commandResponsePointer);
 static void closeConnectionESP8266(ServerContext *context, uint32_t connectionId, char *commandResponsePointer);
+#if ESP8266_TRACE_ENABLED
+static void handleTraceDump(ServerContext *context, HTTPParser *request);
+#endif
 
 
 ServerContext *initServerESP8266(USART_TypeDef *USARTx, ServerConfiguration *configuration) {
@@ -59,36 +187,47 @@ ServerContext *initServerESP8266(USART_TypeDef *USARTx, ServerConfiguration *con
     tmpTxBuffer = getStringRingBufferInstance(TMP_TX_BUFFER_MAX_LENGTH);
     USARTInstance = initBufferedUSART(USARTx, configuration->rxDataBufferSize, ESP8266_INNER_TX_BUFFER_SIZE);
     httpParser = getHttpParserInstance();
+    routeTable = getRouteTableInstance();
 
-    if (tmpTxBuffer == NULL || USARTInstance == NULL || httpParser == NULL) {
+    if (tmpTxBuffer == NULL || USARTInstance == NULL || httpParser == NULL || routeTable == NULL) {
         deleteServerESP8266(context);
         return NULL;
     }
 
     context->txDataBufferPointer = USARTInstance->TxBuffer->dataBuffer;
     dwtDelayInit();
+    TRACE_INIT();
     delay_ms(100);    // initial delay
 
-    sendATCommand(context, "AT+RST");
+    sendBasicATCommand(context, "AT+RST");
     delay_ms(5000);
 
-    if (sendATCommand(context, "AT") != ESP8266_SERVER_SUCCESS) {
+    if (sendBasicATCommand(context, "AT") != ESP8266_SERVER_SUCCESS) {
         deleteServerESP8266(context);
         return NULL;
     }
-    sendATCommand(context, "AT+GMR");
+    sendBasicATCommand(context, "AT+GMR");
     return context;
 }
 
 ServerIPConfig startServerESP8266(ServerContext *context, char *ssid, char *password) {
     ServerIPConfig serverConfig = {0};
     if (!isSsidValid(ssid) || !isPasswordValid(password)) return serverConfig;
-    sendATCommand(context, "AT+CWMODE_DEF=%d", ESP8266_STATION_AND_AP);
-    sendATCommand(context, "AT+CWAUTOCONN=%d", ESP8266_DISABLE_AUTO_CONNECT_TO_AP);
-    sendATCommand(context, "AT+CIPDINFO=%d", ESP8266_SHOW_REQUEST_IP_AND_PORT);    // show ip with +IPD
-    sendATCommand(context, "AT+CWJAP_CUR=\"%s\",\"%s\"", ssid, password);
+    sendNumericATCommand(context, "AT+CWMODE_DEF=", ESP8266_STATION_AND_AP);
+    sendNumericATCommand(context, "AT+CWAUTOCONN=", ESP8266_DISABLE_AUTO_CONNECT_TO_AP);   // reconnect is supervised by server
+    strcpy(stationSsid, ssid);
+    strcpy(stationPassword, password);
+    memset(linkHealth.bssid, 0, sizeof(linkHealth.bssid));
+
+    ATCommand joinCommand = createATCommand(commandBuffer, COMMAND_MAX_LENGTH, "AT+CWJAP_CUR=");
+    appendATQuotedString(&joinCommand, ssid);
+    appendATLiteral(&joinCommand, ",");
+    appendATQuotedString(&joinCommand, password);
+    if (sendATCommand(context, &joinCommand) == ESP8266_SERVER_SUCCESS) {
+        cacheJoinedAccessPoint(context);
+    }
 
-    if (sendATCommand(context, "AT+CIFSR") == ESP8266_SERVER_SUCCESS) {
+    if (sendBasicATCommand(context, "AT+CIFSR") == ESP8266_SERVER_SUCCESS) {
         char *responseBody = USARTInstance->RxBuffer->dataPointer;
 
         char dataBuffer[20] = {[0 ... 20 - 1] = 0};
@@ -99,13 +238,10 @@ ServerIPConfig startServerESP8266(ServerContext *context, char *ssid, char *pass
         substringString("STAMAC,\"", "\"", responseBody, dataBuffer);
         serverConfig.localMAC = macAddressFromString(dataBuffer);
 
-        sendATCommand(context, "AT+CIPMUX=%d", ESP8266_CONNECTION_MULTIPLE);
-        sendATCommand(context, "AT+CIPSERVER=%d,%d", ESP8266_CREATE_SERVER_MODE, context->configuration->serverPort);
-
-        if (context->configuration->serverTimeoutMs <= ESP8266_MAX_ALLOWED_TIMEOUT) {
-            sendATCommand(context, "AT+CIPSTO=%d", context->configuration->serverTimeoutMs);
-        }
+        startListeningESP8266(context);
         context->isServerRunning = true;
+        linkHealth.isConnected = true;
+        lastLinkCheckMs = currentMilliSeconds();
     }
 
     clearStringRingBuffer(USARTInstance->RxBuffer, USARTInstance->RxBuffer->maxSize);
@@ -114,93 +250,398 @@ ServerIPConfig startServerESP8266(ServerContext *context, char *ssid, char *pass
 }
 
 ESP8266ServerStatus startSoftApESP8266(ServerContext *context, char *ssid, char *password, uint16_t channelId, uint8_t encryption) {
-    return sendATCommand(context, "AT+CWSAP_DEF=\"%s\",\"%s\",%d,%d", ssid, password, channelId, encryption);
+    ATCommand softApCommand = createATCommand(commandBuffer, COMMAND_MAX_LENGTH, "AT+CWSAP_DEF=");
+    appendATQuotedString(&softApCommand, ssid);
+    appendATLiteral(&softApCommand, ",");
+    appendATQuotedString(&softApCommand, password);
+    appendATLiteral(&softApCommand, ",");
+    appendATUnsigned(&softApCommand, channelId);
+    appendATLiteral(&softApCommand, ",");
+    appendATUnsigned(&softApCommand, encryption);
+    return sendATCommand(context, &softApCommand);
 }
 
 ESP8266ServerStatus startMulticastDnsESP8266(ServerContext *context, char *host, char *serverName, uint16_t port) {
-    return sendATCommand(context, "AT+MDNS=1,\"%s\",\"%s\",%d", host, serverName, port);
+    ATCommand dnsCommand = createATCommand(commandBuffer, COMMAND_MAX_LENGTH, "AT+MDNS=1,");
+    appendATQuotedString(&dnsCommand, host);
+    appendATLiteral(&dnsCommand, ",");
+    appendATQuotedString(&dnsCommand, serverName);
+    appendATLiteral(&dnsCommand, ",");
+    appendATUnsigned(&dnsCommand, port);
+    return sendATCommand(context, &dnsCommand);
+}
+
+bool addRouteMappingESP8266(ServerContext *context, const char *pathPattern, HTTPMethod method, RequestHandlerFunction handler) {
+    return routeTableAdd(routeTable, pathPattern, method, handler);
+}
+
+bool addPriorityRouteMappingESP8266(ServerContext *context, const char *pathPattern, HTTPMethod method, RequestHandlerFunction handler, RoutePriority priority) {
+    RouteEntry *route = routeTableAdd(routeTable, pathPattern, method, handler);
+    if (route == NULL) return false;
+    route->priority = priority;
+    return true;
+}
+
+const PathVariable *getPathVariableESP8266(const char *name) {
+    return routeMatchGetVariable(&routeMatch, name);
+}
+
+void setAdmissionControlESP8266(uint8_t backlogLimit, uint8_t requestsPerSecond, uint8_t burstSize) {
+    admissionBacklogLimit = backlogLimit;
+    rateLimitPerSecond = requestsPerSecond;
+    rateLimitBurstSize = (burstSize > 0) ? burstSize : 1;
+    memset(clientBuckets, 0, sizeof(clientBuckets));
+}
+
+void setAdmissionCloseOnOverloadESP8266(bool isEnabled) {
+    isOverloadCloseEnabled = isEnabled;
+}
+
+void setLazyRequestParsingESP8266(bool isEnabled) {
+    isLazyRequestParsing = isEnabled;
+}
+
+bool getRequestHeaderESP8266(const char *name, char *valueBuffer, uint32_t bufferSize) {
+    if (requestIndex.isValid) {
+        return requestIndexCopyHeader(&requestIndex, name, valueBuffer, bufferSize);
+    }
+    const char *value = copyMapValue(httpParser->headers, name, valueBuffer, bufferSize);
+    return value != NULL && strlen(value) < bufferSize;
+}
+
+bool getQueryParameterESP8266(const char *name, char *valueBuffer, uint32_t bufferSize) {
+    if (requestIndex.isValid) {
+        return requestIndexCopyQueryParameter(&requestIndex, name, valueBuffer, bufferSize);
+    }
+    return copyMapValue(httpParser->queryParameters, name, valueBuffer, bufferSize) != NULL;  // truncated like indexed value
+}
+
+void loadRequestParametersESP8266(HTTPParser *request) {
+    if (isLazyRequestParsing && requestIndex.isValid) {
+        hashMapClear(request->headers);
+        hashMapClear(request->queryParameters);
+        parseHttpBuffer((char *) requestIndex.request, request, HTTP_REQUEST);
+        parseHttpHeaders(request, (char *) requestIndex.request);
+        parseHttpQueryParameters(request, (char *) requestIndex.request);
+    }
+}
+
+ESP8266ServerStatus enablePassiveReceiveModeESP8266(ServerContext *context) {
+    ATCommand modeCommand = createATCommand(commandBuffer, COMMAND_MAX_LENGTH, "AT+CIPRECVMODE=");
+    appendATUnsigned(&modeCommand, ESP8266_PASSIVE_RECEIVE_MODE);
+    ESP8266ServerStatus status = sendLinkATCommand(context, &modeCommand);   // already received +IPD data is processed as before
+    isPassiveReceiveMode = (status == ESP8266_SERVER_SUCCESS);
+    return status;
 }
 
 void processServerRequestsESP8266(ServerContext *context) {
     if (isStringRingBufferFull(USARTInstance->RxBuffer)) {
+        TRACE_EVENT(TRACE_RX_BUFFER_OVERFLOW, ESP8266_TRACE_NO_LINK, USARTInstance->RxBuffer->maxSize);
         LL_USART_DisableIT_RXNE(USARTInstance->USARTx);
         resetRxBufferUSART(USARTInstance);
         LL_USART_EnableIT_RXNE(USARTInstance->USARTx);
+        memset(pendingRequests, 0, sizeof(pendingRequests));
+        for (uint8_t linkId = 0; linkId < ESP8266_MAX_LINK_COUNT; linkId++) {
+            if (linkTable[linkId].type == ESP8266_LINK_STREAMING_BODY) {
+                abortRequestBody(context, linkId, REQUEST_BODY_ABORT_OVERFLOW);   // body bytes are lost
+            }
+        }
     }
 
+    if (context->isServerRunning) {
+        superviseStationLink(context);
+    }
+
+    if (isPassiveReceiveMode) {
+        pullPendingLinkData(context);   // pulled data looks like active mode +IPD, processed below
+    }
+
+    idleRxLength = getStringRingBufferSize(USARTInstance->RxBuffer);     // reset by releaseProcessedRequest() when request is processed
     char *requestBody = USARTInstance->RxBuffer->dataPointer;
     if (requestBody[0] != '\0') {   // check that rx buffer is not empty
-        char *requestStartPointer = strstr(requestBody, "+IPD,");
-        if (requestStartPointer == NULL) return;
-        char *requestEndPointer = strstr(requestStartPointer, "\r\n\r\n");
-        if (requestEndPointer == NULL) return;
+        detectClosedLinks(context);
+        char *requestStartPointer = (char *) findMarkerSWAR(requestBody, DATA_RECEIVED_STATUS);
+        if (requestStartPointer == NULL) {
+            releaseHandledNotifications(context);
+            return;
+        }
 
         static char ipdMarker[ESP8266_DATA_MARKER_MAX_LENGTH];
         memset(ipdMarker, 0, ESP8266_DATA_MARKER_MAX_LENGTH);
         getIPDMarkerValue(requestStartPointer, ipdMarker);  // ESP8266 Data received +IPD marker
-        if (isStringEmpty(ipdMarker)) return;
-        requestStartPointer += strlen(ipdMarker);
-
-        context->socketId = ipdMarker[ESP8266_IPD_MARKER_REQUEST_ID_INDEX] - '0';   // convert char to id. Example +IPD,0,... -> id is at index 5
-        context->requestIP = parseRequestIPAddress(ipdMarker);
-        uint32_t requestLength = (requestEndPointer - requestBody) + ESP8266_REQUEST_END_MARKER_LENGTH;
-        USARTInstance->RxBuffer->dataPointer += requestLength;  // set to the next request
-
-        parseHttpBuffer(requestStartPointer, httpParser, HTTP_REQUEST);
-        if (httpParser->parserStatus == HTTP_PARSE_OK) {
-            parseHttpHeaders(httpParser, requestStartPointer);
-            parseHttpQueryParameters(httpParser, requestStartPointer);
-            RequestHandlerFunction handlerFunction = handleIncomingServerRequest(context, httpParser);
-            handlerFunction(context, httpParser);
+        if (isStringEmpty(ipdMarker) || ipdMarker[strlen(ipdMarker) - 1] != ':') return;  // wait for complete marker
+
+        uint8_t linkId = ipdMarker[ESP8266_IPD_MARKER_REQUEST_ID_INDEX] - '0';   // convert char to id. Example +IPD,0,... -> id is at index 5
+        TRACE_EVENT_ONCE(TRACE_IPD_START, linkId, strtoul(&ipdMarker[ESP8266_IPD_MARKER_LENGTH_INDEX], NULL, 10));  // recorded once while payload is arriving
+        if (linkId < ESP8266_MAX_LINK_COUNT && linkTable[linkId].type == ESP8266_LINK_UDP) {
+            processDatagram(context, linkId, ipdMarker, requestStartPointer + strlen(ipdMarker));
+        } else if (linkId < ESP8266_MAX_LINK_COUNT && linkTable[linkId].type == ESP8266_LINK_WEBSOCKET) {
+            processWebSocketFrames(context, linkId, ipdMarker, requestStartPointer + strlen(ipdMarker));
+        } else if (linkId < ESP8266_MAX_LINK_COUNT && linkTable[linkId].type == ESP8266_LINK_STREAMING_BODY) {
+            processRequestBody(context, linkId, ipdMarker, requestStartPointer + strlen(ipdMarker));
+        } else {
+            processHttpRequest(context, linkId, ipdMarker, requestStartPointer);
         }
+    }
+}
 
-        bool havePendingRequests = strstr(USARTInstance->RxBuffer->dataPointer, "+IPD,") != NULL;    // check for pending requests
-        if (!havePendingRequests || httpParser->parserStatus != HTTP_PARSE_OK) {  // shrink rx buffer if no new requests arrived
-            LL_USART_DisableIT_RXNE(USARTInstance->USARTx);
-            clearStringRingBuffer(USARTInstance->RxBuffer, USARTInstance->RxBuffer->head);
-            LL_USART_EnableIT_RXNE(USARTInstance->USARTx);
-        }
+ESP8266ServerStatus openUdpLinkESP8266(ServerContext *context, uint8_t linkId, const char *remoteIP, uint16_t remotePort, uint16_t localPort, DatagramHandlerFunction handler) {
+    if (linkId >= ESP8266_MAX_LINK_COUNT || isStringEmpty(remoteIP) || handler == NULL) return ESP8266_SERVER_ERROR;
+    ATCommand startCommand = createATCommand(commandBuffer, COMMAND_MAX_LENGTH, "AT+CIPSTART=");
+    appendATUnsigned(&startCommand, linkId);
+    appendATLiteral(&startCommand, ",\"UDP\",");
+    appendATQuotedString(&startCommand, remoteIP);
+    appendATLiteral(&startCommand, ",");
+    appendATUnsigned(&startCommand, remotePort);
+    appendATLiteral(&startCommand, ",");
+    appendATUnsigned(&startCommand, localPort);
+    appendATLiteral(&startCommand, ",");
+    appendATUnsigned(&startCommand, ESP8266_UDP_MODE_REMOTE_CHANGEABLE);
+    ESP8266ServerStatus status = sendLinkATCommand(context, &startCommand);
+    if (status == ESP8266_SERVER_SUCCESS) {
+        linkTable[linkId].type = ESP8266_LINK_UDP;
+        linkTable[linkId].datagramHandler = handler;
     }
+    return status;
+}
+
+ESP8266ServerStatus sendDatagramESP8266(ServerContext *context, uint8_t linkId, const char *data, uint32_t length) {
+    if (linkId >= ESP8266_MAX_LINK_COUNT || linkTable[linkId].type != ESP8266_LINK_UDP) return ESP8266_SERVER_ERROR;
+    if (data == NULL || length == 0 || length > ESP8266_INNER_TX_BUFFER_SIZE) return ESP8266_SERVER_ERROR;
+
+    flushActiveResponse(context);
+    memcpy(context->txDataBufferPointer, data, length);
+    return sendTxBufferESP8266(context, linkId, length, getCommandResponsePointer());
+}
+
+ESP8266ServerStatus closeUdpLinkESP8266(ServerContext *context, uint8_t linkId) {
+    if (linkId >= ESP8266_MAX_LINK_COUNT || linkTable[linkId].type != ESP8266_LINK_UDP) return ESP8266_SERVER_ERROR;
+    linkTable[linkId].type = ESP8266_LINK_TCP_SERVER;
+    linkTable[linkId].datagramHandler = NULL;
+    closeConnectionESP8266(context, linkId, getCommandResponsePointer());
+    return ESP8266_SERVER_SUCCESS;
 }
 
 void sendServerResponseESP8266(ServerContext *context, HTTPStatus status, HashMap headers, const char *body) {
-    if (headers == NULL) return;
+    uint32_t bodyLength = isStringNotBlank(body) ? strlen(body) : 0;
+    if (beginResponseStreamESP8266(context, status, headers, (int32_t) bodyLength) == ESP8266_SERVER_SUCCESS) {
+        writeResponseStreamESP8266(context, body, bodyLength);
+        endResponseStreamESP8266(context);
+    }
+}
+
+ESP8266ServerStatus beginResponseStreamESP8266(ServerContext *context, HTTPStatus status, HashMap headers, int32_t contentLength) {
+    if (headers == NULL) return ESP8266_SERVER_ERROR;
     hashMapPut(headers, "Server", SERVER_NAME);
     hashMapPut(headers, "Cache-Control", "no-cache");
     hashMapPut(headers, "Pragma", "no-cache");
     hashMapPut(headers, "Accept-Ranges", "bytes");
 
-    uint32_t statusLineLength = formatHTTPServerStatusLine(context->txDataBufferPointer, status);
-    uint32_t headersLength = getHTTPServerHeadersLength(headers);
-    uint32_t bodyLength = isStringNotBlank(body) ? strlen(body) : 0;
-    uint32_t totalResponseLength = statusLineLength + headersLength + bodyLength;
+    char dataLengthBuffer[sizeof(uint32_t) * 8 + 1] = {0};    // u32 max length
+    bool isChunked = contentLength < 0;
+    if (isChunked) {
+        if (!isChunkedResponseAccepted()) {   //Not to send transfer-encoded messages to non-HTTP/1.1 applications.
+            hashMapPut(headers, "Connection", "close");
+            if (beginResponseStreamESP8266(context, HTTP_NOT_IMPLEMENTED, headers, 0) == ESP8266_SERVER_SUCCESS) {
+                endResponseStreamESP8266(context);
+            }
+            return ESP8266_SERVER_ERROR;
+        }
+        hashMapRemove(headers, "Content-Length");   // removing content length header for chunked response if present
+        hashMapPut(headers, "Transfer-Encoding", "chunked");
+    } else {
+        formatUnsignedDecimal(dataLengthBuffer, (uint32_t) contentLength);
+        hashMapRemove(headers, "Transfer-Encoding");
+        hashMapPut(headers, "Content-Length", dataLengthBuffer);
+    }
 
-    uint32_t bytesInRxBuffer = (USARTInstance->RxBuffer->dataPointer - USARTInstance->RxBuffer->dataBuffer);
-    char *commandResponsePointer = USARTInstance->RxBuffer->dataPointer + (USARTInstance->RxBuffer->head - bytesInRxBuffer);
+    formatHTTPServerStatusLine(context->txDataBufferPointer, status);
+    formatHTTPServerHeaders(context->txDataBufferPointer, headers);
+    char *connectionStatus = hashMapGet(headers, getHeaderValueByKey(CONNECTION));
 
-    if (totalResponseLength <= (ESP8266_INNER_TX_BUFFER_SIZE - ESP8266_ADDITIONAL_HEADER_LENGTH)) {
-        ESP8266ServerStatus responseSendStatus = sendSingleResponse(context, headers, body, bodyLength, commandResponsePointer);
-        if (responseSendStatus != ESP8266_SERVER_SUCCESS) {
-            return;
+    responseSegmenter.linkId = context->socketId;
+    responseSegmenter.length = strlen(context->txDataBufferPointer);
+    responseSegmenter.isChunked = isChunked;
+    responseSegmenter.isChunkOpen = false;
+    responseSegmenter.isConnectionClose = isStringEquals(connectionStatus, "close");
+    responseSegmenter.commandResponsePointer = getCommandResponsePointer();
+    responseSegmenter.status = (responseSegmenter.length < ESP8266_INNER_TX_BUFFER_SIZE) ? ESP8266_SERVER_SUCCESS : ESP8266_SERVER_ERROR_BUFFER_FULL;
+    responseSegmenter.isActive = (responseSegmenter.status == ESP8266_SERVER_SUCCESS);
+    return responseSegmenter.status;
+}
+
+ESP8266ServerStatus writeResponseStreamESP8266(ServerContext *context, const char *data, uint32_t length) {
+    char *txBuffer = context->txDataBufferPointer;
+    while (length > 0 && responseSegmenter.status == ESP8266_SERVER_SUCCESS) {
+        if (responseSegmenter.isChunked && !responseSegmenter.isChunkOpen) {
+            if (responseSegmenter.length + ESP8266_CHUNK_FRAMING_LENGTH >= ESP8266_INNER_TX_BUFFER_SIZE) {
+                flushResponseSegment(context);
+                continue;
+            }
+            responseSegmenter.chunkStart = responseSegmenter.length;    // chunk size is written when segment is full
+            responseSegmenter.length += ESP8266_CHUNK_SIZE_FIELD_LENGTH;
+            responseSegmenter.isChunkOpen = true;
         }
 
-    } else if (totalResponseLength >= ESP8266_INNER_TX_BUFFER_SIZE) {
-        if (isStringNotEquals(httpParser->httpVersion, SERVER_HTTP_VERSION)) {   //Not to send transfer-encoded messages to non-HTTP/1.1 applications.
-            formatHTTPServerStatusLine(context->txDataBufferPointer, HTTP_NOT_IMPLEMENTED);
-            sendSingleResponse(context, headers, NULL, 0, commandResponsePointer);
-            closeConnectionESP8266(context, context->socketId, commandResponsePointer);
-            return;
+        uint32_t reservedLength = responseSegmenter.isChunked ? ESP8266_CHUNK_END_LENGTH : 0;
+        uint32_t capacity = ESP8266_INNER_TX_BUFFER_SIZE - responseSegmenter.length - reservedLength;
+        uint32_t copyLength = (length < capacity) ? length : capacity;
+        memcpy(&txBuffer[responseSegmenter.length], data, copyLength);
+        responseSegmenter.length += copyLength;
+        data += copyLength;
+        length -= copyLength;
+
+        if (copyLength == capacity) {   // segment is packed to the module limit
+            flushResponseSegment(context);
         }
+    }
+    return responseSegmenter.status;
+}
 
-        ESP8266ServerStatus responseSendStatus = sendChunkedResponse(context, headers, body, bodyLength, commandResponsePointer);
-        if (responseSendStatus != ESP8266_SERVER_SUCCESS) {
-            return;
+ESP8266ServerStatus endResponseStreamESP8266(ServerContext *context) {
+    if (responseSegmenter.isChunked && responseSegmenter.status == ESP8266_SERVER_SUCCESS) {
+        closeResponseChunk(context->txDataBufferPointer);
+        if (responseSegmenter.length + ESP8266_LAST_CHUNK_LENGTH > ESP8266_INNER_TX_BUFFER_SIZE) {
+            flushResponseSegment(context);
         }
+        memcpy(&context->txDataBufferPointer[responseSegmenter.length], ESP8266_LAST_CHUNK, ESP8266_LAST_CHUNK_LENGTH);
+        responseSegmenter.length += ESP8266_LAST_CHUNK_LENGTH;
     }
 
-    char *connectionStatus = hashMapGet(headers, getHeaderValueByKey(CONNECTION));
-    if (isStringEquals(connectionStatus, "close")) {
-        closeConnectionESP8266(context, context->socketId, commandResponsePointer);
+    if (responseSegmenter.length > 0 && responseSegmenter.status == ESP8266_SERVER_SUCCESS) {
+        flushResponseSegment(context);
+    }
+
+    if (responseSegmenter.status == ESP8266_SERVER_SUCCESS && responseSegmenter.isConnectionClose) {
+        closeConnectionESP8266(context, responseSegmenter.linkId, responseSegmenter.commandResponsePointer);
+    }
+    responseSegmenter.length = 0;
+    responseSegmenter.isActive = false;
+    return responseSegmenter.status;
+}
+
+ESP8266ServerStatus sendTemplateResponseESP8266(ServerContext *context, HTTPStatus status, HashMap headers, const HTMLTemplate *htmlTemplate, const char *const *slotValues) {
+    int32_t contentLength = htmlTemplate->isFixedLength ? (int32_t) htmlTemplate->fixedLength : -1;
+    ESP8266ServerStatus serverStatus = beginResponseStreamESP8266(context, status, headers, contentLength);
+    for (uint16_t i = 0; i < htmlTemplate->segmentCount && serverStatus == ESP8266_SERVER_SUCCESS; i++) {
+        const TemplateSegment *segment = &htmlTemplate->segments[i];
+        if (segment->text != NULL) {
+            serverStatus = writeResponseStreamESP8266(context, segment->text, segment->length);
+        } else {
+            serverStatus = writeTemplateSlot(context, segment, slotValues[segment->slotIndex]);
+        }
+    }
+    ESP8266ServerStatus endStatus = endResponseStreamESP8266(context);   // also after failed write, next response must not inherit open stream
+    return serverStatus == ESP8266_SERVER_SUCCESS ? endStatus : serverStatus;
+}
+
+bool addRequestBodyMappingESP8266(ServerContext *context, const char *pathPattern, HTTPMethod method, const RequestBodyConsumer *consumer) {
+    if (consumer == NULL || consumer->onData == NULL || consumer->onComplete == NULL) return false;
+    RouteEntry *route = routeTableAdd(routeTable, pathPattern, method, handleStreamedRequestBody);
+    if (route == NULL) return false;
+    route->attachment = consumer;
+    return true;
+}
+
+bool addTraceRouteESP8266(ServerContext *context, const char *path) {
+#if ESP8266_TRACE_ENABLED
+    return routeTableAdd(routeTable, path, HTTP_GET, handleTraceDump) != NULL;
+#else
+    return false;
+#endif
+}
+
+bool addWebSocketMappingESP8266(ServerContext *context, const char *pathPattern, const WebSocketHandlers *handlers) {
+    if (handlers == NULL) return false;
+    RouteEntry *route = routeTableAdd(routeTable, pathPattern, HTTP_GET, handleWebSocketUpgrade);
+    if (route == NULL) return false;
+    route->attachment = handlers;
+    return true;
+}
+
+ESP8266ServerStatus sendWebSocketFrameESP8266(ServerContext *context, uint8_t linkId, WebSocketOpcode opcode, const char *data, uint32_t length) {
+    if (linkId >= ESP8266_MAX_LINK_COUNT || linkTable[linkId].type != ESP8266_LINK_WEBSOCKET) return ESP8266_SERVER_ERROR;
+    if (length + WEBSOCKET_MAX_SERVER_HEADER_LENGTH > ESP8266_INNER_TX_BUFFER_SIZE || (data == NULL && length > 0)) return ESP8266_SERVER_ERROR;
+
+    flushActiveResponse(context);
+    uint8_t headerLength = formatWebSocketFrameHeader(context->txDataBufferPointer, opcode, length);
+    memcpy(context->txDataBufferPointer + headerLength, data, length);
+    ESP8266ServerStatus status = sendTxBufferESP8266(context, linkId, headerLength + length, getCommandResponsePointer());
+    if (status != ESP8266_SERVER_SUCCESS) {
+        closeWebSocketLink(context, linkId, false);
+    }
+    return status;
+}
+
+uint8_t broadcastWebSocketFrameESP8266(ServerContext *context, WebSocketOpcode opcode, const char *data, uint32_t length) {
+    uint8_t sentCount = 0;
+    for (uint8_t linkId = 0; linkId < ESP8266_MAX_LINK_COUNT; linkId++) {
+        if (linkTable[linkId].type == ESP8266_LINK_WEBSOCKET &&
+            sendWebSocketFrameESP8266(context, linkId, opcode, data, length) == ESP8266_SERVER_SUCCESS) {
+            sentCount++;
+        }
+    }
+    return sentCount;
+}
+
+const ESP8266LinkHealth *getLinkHealthESP8266() {
+    return &linkHealth;
+}
+
+uint32_t getNextDeadlineESP8266(ServerContext *context) {
+    if (isStringRingBufferFull(USARTInstance->RxBuffer)) return 0;   // overflow reset, no more bytes arrive to wake the core
+    if (getStringRingBufferSize(USARTInstance->RxBuffer) != idleRxLength) return 0;   // received or pending request data is not processed yet
+    for (uint8_t linkId = 0; linkId < ESP8266_MAX_LINK_COUNT; linkId++) {
+        if (linkTable[linkId].pendingReceiveLength > 0 && !isPullDeferred) return 0;  // passive mode data waits to be pulled
+    }
+    if (!context->isServerRunning) return ESP8266_NO_DEADLINE;
+
+    uint32_t checkPeriodMs = linkHealth.isConnected ? ESP8266_LINK_CHECK_PERIOD_MS : ESP8266_RECONNECT_PERIOD_MS;
+    uint32_t elapsedMs = currentMilliSeconds() - lastLinkCheckMs;
+    return (elapsedMs < checkPeriodMs && !isLinkCheckDue) ? checkPeriodMs - elapsedMs : 0;
+}
+
+void idleServerESP8266(ServerContext *context) {
+    __disable_irq();    // received byte between check and WFI still wakes the core, it stays pending
+    uint32_t timeoutMs = getNextDeadlineESP8266(context);
+    if (timeoutMs > 0) {
+        sleepUntilEventESP8266(timeoutMs);
+    }
+    __enable_irq();
+}
+
+__attribute__((weak)) void sleepUntilEventESP8266(uint32_t timeoutMs) {
+    if (SysTick->CTRL & SysTick_CTRL_TICKINT_Msk) {  // periodic tick interrupt already limits sleep time
+        __WFI();
+        return;
+    }
+
+    uint32_t cyclesPerTick = (SysTick->CTRL & SysTick_CTRL_CLKSOURCE_Msk) ? 1 : SYSTICK_HCLK_DIVIDER;
+    uint32_t ticksPerMs = SystemCoreClock / 1000 / cyclesPerTick;
+    uint32_t maxTimeoutMs = SysTick_LOAD_RELOAD_Msk / ticksPerMs;
+    if (timeoutMs > maxTimeoutMs) {
+        timeoutMs = maxTimeoutMs;   // caller loop sleeps again
+    }
+
+    uint32_t savedControl = SysTick->CTRL;
+    uint32_t savedReload = SysTick->LOAD;
+    SysTick->LOAD = timeoutMs * ticksPerMs - 1;    // one-shot, LL_mDelay() configuration is restored after wakeup
+    SysTick->VAL = 0;
+    SysTick->CTRL = savedControl | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+    uint32_t cycleCountBefore = DWT->CYCCNT;
+
+    __WFI();
+
+    uint32_t control = SysTick->CTRL;   // reading clears COUNTFLAG
+    uint32_t elapsedTicks = (control & SysTick_CTRL_COUNTFLAG_Msk) ? SysTick->LOAD + 1 : SysTick->LOAD - SysTick->VAL;
+    SysTick->CTRL = savedControl;
+    SysTick->LOAD = savedReload;
+    SysTick->VAL = 0;
+
+    uint32_t sleptCycles = elapsedTicks * cyclesPerTick;
+    uint32_t countedCycles = DWT->CYCCNT - cycleCountBefore;
+    if (countedCycles < sleptCycles) {  // core clock is gated in sleep unless DBGMCU_CR_DBG_SLEEP is set, keep currentMilliSeconds() running
+        DWT->CYCCNT += sleptCycles - countedCycles;
     }
 }
 
@@ -209,23 +650,27 @@ void deleteServerESP8266(ServerContext *context) {
     deleteUSART(USARTInstance);
     stringRingBufferDelete(tmpTxBuffer);
     deleteHttpParser(httpParser);
+    routeTableDelete(routeTable);
     httpParser = NULL;
     tmpTxBuffer = NULL;
+    routeTable = NULL;
+}
+
+static ESP8266ServerStatus sendATCommand(ServerContext *context, ATCommand *command) {
+    return sendATCommandAttempts(context, command, ESP8266_KEEPALIVE_ATTEMPT_COUNT);
 }
 
-static ESP8266ServerStatus sendATCommand(ServerContext *context, const char *ATCommandPattern, ...) {
+static ESP8266ServerStatus sendATCommandAttempts(ServerContext *context, ATCommand *command, uint8_t attemptCount) {
+    if (!finishATCommand(command)) return ESP8266_SERVER_ERROR;   // command doesn't fit to buffer
+    flushActiveResponse(context);
     resetTxBufferUSART(USARTInstance);
-    memset(commandBuffer, 0, COMMAND_MAX_LENGTH);
-    va_list valist;
-    va_start(valist, ATCommandPattern);
-    vsprintf(commandBuffer, ATCommandPattern, valist);
-    va_end(valist);
-    strcat(commandBuffer, NEW_LINE);  // ESP8266 expects <CR><LF> or CarriageReturn and LineFeed at the end of each command
-
-    for (uint8_t i = 0; i < ESP8266_KEEPALIVE_ATTEMPT_COUNT; i++) {
+
+    for (uint8_t i = 0; i < attemptCount; i++) {
         clearStringRingBuffer(USARTInstance->RxBuffer, COMMAND_MAX_LENGTH);
-        sendStringUSART(USARTInstance, commandBuffer);
-        ESP8266ServerStatus status = readCommandResponse(context, USARTInstance->RxBuffer->dataPointer);
+        TRACE_EVENT(TRACE_AT_COMMAND, ESP8266_TRACE_NO_LINK, command->length);
+        sendDataUSART(USARTInstance, command->buffer, command->length);
+        ESP8266ServerStatus status = readCommandResponse(context, USARTInstance->RxBuffer->dataPointer, RESPONSE_STATUS_SUCCESS_MASK);
+        TRACE_EVENT(TRACE_AT_RESPONSE, ESP8266_TRACE_NO_LINK, status);
         if (status != ESP8266_SERVER_TIMEOUT) {
             return status;
         }
@@ -233,60 +678,908 @@ static ESP8266ServerStatus sendATCommand(ServerContext *context, const char *ATC
     return ESP8266_SERVER_TIMEOUT;
 }
 
-static ESP8266ServerStatus readCommandResponse(ServerContext *context, char *rxBufferPointer) {
+static ESP8266ServerStatus sendLinkATCommand(ServerContext *context, ATCommand *command) {  // safe while server is running, response is read after received data
+    if (!finishATCommand(command)) return ESP8266_SERVER_ERROR;
+    flushActiveResponse(context);
+    char *commandResponsePointer = getCommandResponsePointer();
+    TRACE_EVENT(TRACE_AT_COMMAND, ESP8266_TRACE_NO_LINK, command->length);
+    sendDataUSART(USARTInstance, command->buffer, command->length);
+    ESP8266ServerStatus status = readCommandResponse(context, commandResponsePointer, RESPONSE_STATUS_SUCCESS_MASK);
+    TRACE_EVENT(TRACE_AT_RESPONSE, ESP8266_TRACE_NO_LINK, status);
+    return status;
+}
+
+static ESP8266ServerStatus sendBasicATCommand(ServerContext *context, const char *command) {
+    ATCommand atCommand = createATCommand(commandBuffer, COMMAND_MAX_LENGTH, command);
+    return sendATCommand(context, &atCommand);
+}
+
+static ESP8266ServerStatus sendNumericATCommand(ServerContext *context, const char *command, uint32_t value) {
+    ATCommand atCommand = createATCommand(commandBuffer, COMMAND_MAX_LENGTH, command);
+    appendATUnsigned(&atCommand, value);
+    return sendATCommand(context, &atCommand);
+}
+
+static ESP8266ServerStatus readCommandResponse(ServerContext *context, char *rxBufferPointer, uint8_t successMask) {
     uint32_t startTimeMillis = currentMilliSeconds();
-    ESP8266ServerStatus status = ESP8266_SERVER_TIMEOUT;
-    uint32_t byteCountInBuffer;
+    ResponseMatcher matcher;
+    resetResponseMatcher(&matcher, rxBufferPointer);
+
+    while ((currentMilliSeconds() - startTimeMillis) < context->configuration->serverTimeoutMs) {
+        char *receivedDataEnd = USARTInstance->RxBuffer->dataBuffer + getStringRingBufferSize(USARTInstance->RxBuffer);
+        uint8_t responseStatus = feedResponseMatcher(&matcher, receivedDataEnd);   // only new bytes, returns as soon as terminal line arrives
+        if (responseStatus & successMask) {
+            return ESP8266_SERVER_SUCCESS;
+        } else if (responseStatus & RESPONSE_STATUS_FAILURE_MASK) {
+            return ESP8266_SERVER_ERROR;
+        } else if (isRxBufferFullUSART(USARTInstance)) {
+            return ESP8266_SERVER_ERROR_BUFFER_FULL;
+        }
+        waitForReceivedData(context, receivedDataEnd, startTimeMillis);
+    }
+    return ESP8266_SERVER_TIMEOUT;
+}
+
+static void waitForReceivedData(ServerContext *context, const char *receivedDataEnd, uint32_t startTimeMillis) {
+    uint32_t elapsedMs = currentMilliSeconds() - startTimeMillis;
+    if (elapsedMs >= context->configuration->serverTimeoutMs) return;
+
+    __disable_irq();
+    if (USARTInstance->RxBuffer->dataBuffer + getStringRingBufferSize(USARTInstance->RxBuffer) == receivedDataEnd) {
+        sleepUntilEventESP8266(context->configuration->serverTimeoutMs - elapsedMs);  // woken by next received byte
+    }
+    __enable_irq();
+}
+
+static inline bool isSsidValid(char *ssid) {
+    return (isStringNotBlank(ssid) && strlen(ssid) < ESP8266_MAX_SSID_LENGTH);
+}
+
+static inline bool isPasswordValid(char *password) {
+    return (isStringNotBlank(password) && strlen(password) < ESP8266_MAX_PASSWORD_LENGTH);
+}
+
+static void processHttpRequest(ServerContext *context, uint8_t linkId, char *ipdMarker, char *requestStartPointer) {
+    char *firstIpdPointer = requestStartPointer;
+    uint8_t backlogCount = 1;
+    if (linkId < ESP8266_MAX_LINK_COUNT && findMarkerSWAR(firstIpdPointer + 1, DATA_RECEIVED_STATUS) != NULL) {  // several requests are waiting
+        requestStartPointer = selectPendingRequest(firstIpdPointer, &backlogCount);
+        if (requestStartPointer != firstIpdPointer) {
+            memset(ipdMarker, 0, ESP8266_DATA_MARKER_MAX_LENGTH);
+            getIPDMarkerValue(requestStartPointer, ipdMarker);
+            linkId = ipdMarker[ESP8266_IPD_MARKER_REQUEST_ID_INDEX] - '0';
+        }
+    }
+
+    char *ipdPointer = requestStartPointer;
+    const char *requestEndPointer = findMarkerSWAR(requestStartPointer, REQUEST_END_MARKER);
+    if (requestEndPointer == NULL) return;
+    if (isPassiveReceiveMode && !isRequestHeaderReceived(ipdPointer, ipdMarker)) return;    // pulled part ends inside header, "\r\nOK\r\n" of response follows it
+    if (linkId < ESP8266_MAX_LINK_COUNT) {
+        pendingRequests[linkId].ipdPointer = NULL;
+    }
+    requestStartPointer += strlen(ipdMarker);
+    currentRequestPointer = requestStartPointer;
+    currentSegmentEnd = requestStartPointer + strtoul(&ipdMarker[ESP8266_IPD_MARKER_LENGTH_INDEX], NULL, 10);
+    requestIndex.isValid = false;
+
+    context->socketId = linkId;
+    context->requestIP = parseRequestIPAddress(ipdMarker);
+    if (ipdPointer == firstIpdPointer) {
+        uint32_t requestLength = (requestEndPointer - USARTInstance->RxBuffer->dataPointer) + ESP8266_REQUEST_END_MARKER_LENGTH;
+        USARTInstance->RxBuffer->dataPointer += requestLength;  // set to the next request
+    } else {
+        ipdPointer[0] = ' ';    // served ahead of older requests, mark as handled
+    }
+    TRACE_EVENT(TRACE_IPD_END, linkId, currentSegmentEnd - requestStartPointer);
+
+    RequestHandlerFunction handlerFunction = NULL;
+    if (isLazyRequestParsing && indexHttpRequest(&requestIndex, requestStartPointer)) {   // single pass offset table, HTTP parser runs only on demand
+        handlerFunction = resolveIndexedRequestHandler();
+    }
+
+    bool isRequestParsed = handlerFunction != NULL;
+    if (isRequestParsed) {  // parser is skipped, fields of previous request must not reach handler
+        hashMapClear(httpParser->headers);
+        hashMapClear(httpParser->queryParameters);
+        httpParser->uriPath[0] = '\0';
+    } else {
+        parseHttpBuffer(requestStartPointer, httpParser, HTTP_REQUEST);
+        isRequestParsed = httpParser->parserStatus == HTTP_PARSE_OK;
+        if (isRequestParsed) {  // regex mappings and default handler read maps in both modes
+            parseHttpHeaders(httpParser, requestStartPointer);
+            parseHttpQueryParameters(httpParser, requestStartPointer);
+            handlerFunction = resolveRequestHandler(context);
+        }
+    }
+
+    if (isRequestParsed) {
+        if (isRequestAdmitted(context, backlogCount)) {
+            TRACE_EVENT(TRACE_HANDLER_ENTER, linkId, ESP8266_LINK_TCP_SERVER);
+            handlerFunction(context, httpParser);
+            TRACE_EVENT(TRACE_HANDLER_EXIT, linkId, ESP8266_LINK_TCP_SERVER);
+        } else {
+            rejectRequest(context, backlogCount);
+        }
+    }
+    releaseProcessedRequest(context, !isRequestParsed);
+}
+
+static void processDatagram(ServerContext *context, uint8_t linkId, char *ipdMarker, char *payloadPointer) {
+    uint32_t payloadLength = strtoul(&ipdMarker[ESP8266_IPD_MARKER_LENGTH_INDEX], NULL, 10);
+    char *receivedDataEnd = USARTInstance->RxBuffer->dataBuffer + getStringRingBufferSize(USARTInstance->RxBuffer);
+    if ((uint32_t) (receivedDataEnd - payloadPointer) < payloadLength) return;  // wait for the whole datagram
+
+    IPAddress remoteIP = parseRequestIPAddress(ipdMarker);
+    char *portPointer = strrchr(ipdMarker, ',');
+    uint16_t remotePort = (portPointer != NULL) ? strtoul(portPointer + 1, NULL, 10) : 0;
+    USARTInstance->RxBuffer->dataPointer = payloadPointer + payloadLength;
+    TRACE_EVENT(TRACE_IPD_END, linkId, payloadLength);
+    TRACE_EVENT(TRACE_HANDLER_ENTER, linkId, ESP8266_LINK_UDP);
+    linkTable[linkId].datagramHandler(context, linkId, payloadPointer, payloadLength, remoteIP, remotePort);
+    TRACE_EVENT(TRACE_HANDLER_EXIT, linkId, ESP8266_LINK_UDP);
+    releaseProcessedRequest(context, false);
+}
+
+static void processWebSocketFrames(ServerContext *context, uint8_t linkId, char *ipdMarker, char *payloadPointer) {
+    uint32_t payloadLength = strtoul(&ipdMarker[ESP8266_IPD_MARKER_LENGTH_INDEX], NULL, 10);
+    char *receivedDataEnd = USARTInstance->RxBuffer->dataBuffer + getStringRingBufferSize(USARTInstance->RxBuffer);
+    if ((uint32_t) (receivedDataEnd - payloadPointer) < payloadLength) return;  // wait for the whole TCP segment
+    USARTInstance->RxBuffer->dataPointer = payloadPointer + payloadLength;
+    TRACE_EVENT(TRACE_IPD_END, linkId, payloadLength);
+
+    const WebSocketHandlers *handlers = linkTable[linkId].webSocketHandlers;
+    WebSocketFrame frame;
+    uint32_t offset = 0;
+    while (offset < payloadLength && linkTable[linkId].type == ESP8266_LINK_WEBSOCKET) {
+        if (parseWebSocketFrame(payloadPointer + offset, payloadLength - offset, &frame) != WEBSOCKET_FRAME_OK) {
+            closeWebSocketLink(context, linkId, false);   // invalid frame or frame split between segments
+            break;
+        }
+        offset += frame.frameLength;
+
+        if (frame.opcode == WEBSOCKET_OPCODE_PING) {
+            sendWebSocketFrameESP8266(context, linkId, WEBSOCKET_OPCODE_PONG, frame.payload, frame.payloadLength);
+        } else if (frame.opcode == WEBSOCKET_OPCODE_CLOSE) {
+            sendWebSocketFrameESP8266(context, linkId, WEBSOCKET_OPCODE_CLOSE, frame.payload, frame.payloadLength < 2 ? frame.payloadLength : 2);  // echo status code
+            closeWebSocketLink(context, linkId, false);
+        } else if (frame.opcode != WEBSOCKET_OPCODE_PONG && handlers->onMessage != NULL) {
+            TRACE_EVENT(TRACE_HANDLER_ENTER, linkId, ESP8266_LINK_WEBSOCKET);
+            handlers->onMessage(context, linkId, frame.opcode, frame.isFinal, frame.payload, frame.payloadLength);
+            TRACE_EVENT(TRACE_HANDLER_EXIT, linkId, ESP8266_LINK_WEBSOCKET);
+        }
+    }
+    releaseProcessedRequest(context, false);
+}
 
-    while (true) {
+static void processRequestBody(ServerContext *context, uint8_t linkId, char *ipdMarker, char *payloadPointer) {
+    uint32_t payloadLength = strtoul(&ipdMarker[ESP8266_IPD_MARKER_LENGTH_INDEX], NULL, 10);
+    char *receivedDataEnd = USARTInstance->RxBuffer->dataBuffer + getStringRingBufferSize(USARTInstance->RxBuffer);
+    if ((uint32_t) (receivedDataEnd - payloadPointer) < payloadLength) return;  // wait for the whole TCP segment
+    USARTInstance->RxBuffer->dataPointer = payloadPointer + payloadLength;
+    TRACE_EVENT(TRACE_IPD_END, linkId, payloadLength);
+    consumeRequestBody(context, linkId, payloadPointer, payloadLength);
+    releaseProcessedRequest(context, false);
+}
+
+static void handleStreamedRequestBody(ServerContext *context, HTTPParser *request) {
+    if (!requestIndex.isValid) {
+        indexHttpRequest(&requestIndex, currentRequestPointer);
+    }
+
+    uint8_t linkId = context->socketId;
+    ESP8266Link *link = &linkTable[linkId];
+    uint16_t contentLengthSize = 0;
+    const char *contentLength = requestIndexFindHeader(&requestIndex, "Content-Length", &contentLengthSize);
+    if (requestIndexIsHeaderEquals(&requestIndex, "Transfer-Encoding", "chunked")) {
+        initChunkedDecoder(&link->bodyDecoder);
+    } else if (contentLength != NULL && contentLengthSize > 0) {
+        initContentLengthDecoder(&link->bodyDecoder, strtoul(contentLength, NULL, 10));
+    } else {
+        HashMap headers = request->headers;
+        hashMapClear(headers);
+        hashMapPut(headers, "Connection", "close");
+        sendServerResponseESP8266(context, HTTP_BAD_REQUEST, headers, NULL);   // body length is unknown
+        return;
+    }
+
+    if (requestIndexIsHeaderEquals(&requestIndex, "Expect", "100-continue")) {  // client waits before sending body
+        strcpy(context->txDataBufferPointer, CONTINUE_RESPONSE);
+        sendTxBufferESP8266(context, linkId, strlen(CONTINUE_RESPONSE), getCommandResponsePointer());
+    }
+
+    link->type = ESP8266_LINK_STREAMING_BODY;
+    link->bodyConsumer = routeMatch.route->attachment;
+    if (link->bodyConsumer->onBegin != NULL) {
+        link->bodyConsumer->onBegin(context, request);
+    }
+
+    char *bodyStart = USARTInstance->RxBuffer->dataPointer;  // body bytes sharing segment with headers
+    uint32_t startTimeMillis = currentMilliSeconds();
+    char *receivedDataEnd;
+    while ((receivedDataEnd = USARTInstance->RxBuffer->dataBuffer + getStringRingBufferSize(USARTInstance->RxBuffer)) < currentSegmentEnd) {
         if ((currentMilliSeconds() - startTimeMillis) >= context->configuration->serverTimeoutMs) {
+            abortRequestBody(context, linkId, REQUEST_BODY_ABORT_TIMEOUT);    // body bytes of this segment are incomplete
+            return;
+        }
+        waitForReceivedData(context, receivedDataEnd, startTimeMillis);
+    }
+
+    USARTInstance->RxBuffer->dataPointer = currentSegmentEnd;
+    consumeRequestBody(context, linkId, bodyStart, currentSegmentEnd - bodyStart);  // completes at once when body is empty
+}
+
+static void consumeRequestBody(ServerContext *context, uint8_t linkId, const char *data, uint32_t length) {
+    ESP8266Link *link = &linkTable[linkId];
+    const RequestBodyConsumer *consumer = link->bodyConsumer;
+    uint32_t offset = 0;
+    while (offset < length && !isRequestBodyFinished(&link->bodyDecoder)) {
+        const char *body;
+        uint32_t bodyLength;
+        offset += decodeRequestBody(&link->bodyDecoder, data + offset, length - offset, &body, &bodyLength);
+        if (bodyLength > 0) {
+            TRACE_EVENT(TRACE_HANDLER_ENTER, linkId, ESP8266_LINK_STREAMING_BODY);
+            consumer->onData(context, linkId, body, bodyLength);
+            TRACE_EVENT(TRACE_HANDLER_EXIT, linkId, ESP8266_LINK_STREAMING_BODY);
+        }
+    }
+
+    if (!isRequestBodyFinished(&link->bodyDecoder)) return;   // wait for next +IPD segment
+    if (link->bodyDecoder.state != REQUEST_BODY_COMPLETE) {
+        abortRequestBody(context, linkId, REQUEST_BODY_ABORT_INVALID);
+        return;
+    }
+
+    link->type = ESP8266_LINK_TCP_SERVER;
+    link->bodyConsumer = NULL;
+    context->socketId = linkId;
+    hashMapClear(httpParser->headers);  // request headers are overwritten by later requests, map is reused for response
+    consumer->onComplete(context, httpParser);
+}
+
+static void abortRequestBody(ServerContext *context, uint8_t linkId, RequestBodyAbortReason reason) {
+    ESP8266Link *link = &linkTable[linkId];
+    const RequestBodyConsumer *consumer = link->bodyConsumer;
+    link->type = ESP8266_LINK_TCP_SERVER;
+    link->bodyConsumer = NULL;
+    if (consumer != NULL && consumer->onAbort != NULL) {
+        consumer->onAbort(context, linkId, reason);
+    }
+
+    if (reason == REQUEST_BODY_ABORT_INVALID) {
+        context->socketId = linkId;
+        HashMap headers = httpParser->headers;
+        hashMapClear(headers);
+        hashMapPut(headers, "Connection", "close");
+        sendServerResponseESP8266(context, HTTP_BAD_REQUEST, headers, NULL);
+    } else if (reason != REQUEST_BODY_ABORT_DISCONNECTED) {
+        closeConnectionESP8266(context, linkId, getCommandResponsePointer());   // rest of body would be taken as next request
+    }
+}
+
+static void handleWebSocketUpgrade(ServerContext *context, HTTPParser *request) {
+    if (!requestIndex.isValid) {
+        indexHttpRequest(&requestIndex, currentRequestPointer);
+    }
+
+    uint16_t clientKeyLength = 0;
+    const char *clientKey = requestIndexFindHeader(&requestIndex, "Sec-WebSocket-Key", &clientKeyLength);
+    static char acceptKey[WEBSOCKET_ACCEPT_KEY_LENGTH + 1];
+
+    if (!requestIndexIsHeaderEquals(&requestIndex, "Upgrade", "websocket") ||
+        !createWebSocketAcceptKey(clientKey, clientKeyLength, acceptKey)) {
+        HashMap headers = request->headers;
+        hashMapClear(headers);
+        hashMapPut(headers, "Connection", "close");
+        sendServerResponseESP8266(context, HTTP_BAD_REQUEST, headers, NULL);
+        return;
+    }
+
+    char *txBuffer = context->txDataBufferPointer;
+    strcpy(txBuffer, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ");
+    strcat(txBuffer, acceptKey);
+    strcat(txBuffer, "\r\n\r\n");
+
+    if (sendTxBufferESP8266(context, context->socketId, strlen(txBuffer), getCommandResponsePointer()) == ESP8266_SERVER_SUCCESS) {
+        const WebSocketHandlers *handlers = routeMatch.route->attachment;
+        linkTable[context->socketId].type = ESP8266_LINK_WEBSOCKET;
+        linkTable[context->socketId].webSocketHandlers = handlers;
+        if (handlers->onOpen != NULL) {
+            handlers->onOpen(context, context->socketId);
+        }
+    }
+}
+
+static void closeWebSocketLink(ServerContext *context, uint8_t linkId, bool isConnectionClosed) {
+    const WebSocketHandlers *handlers = linkTable[linkId].webSocketHandlers;
+    linkTable[linkId].type = ESP8266_LINK_TCP_SERVER;
+    linkTable[linkId].webSocketHandlers = NULL;
+    if (!isConnectionClosed) {
+        closeConnectionESP8266(context, linkId, getCommandResponsePointer());
+    }
+    if (handlers != NULL && handlers->onClose != NULL) {
+        handlers->onClose(context, linkId);
+    }
+}
+
+static void detectClosedLinks(ServerContext *context) {   // "<id>,CLOSED" is sent by module when client disconnects
+    char *closedPointer = findNotificationLine(USARTInstance->RxBuffer->dataBuffer, LINK_CLOSED_STATUS, 1);  // served requests keep their markers, body is skipped too
+    while (closedPointer != NULL) {
+        uint8_t linkId = (closedPointer > USARTInstance->RxBuffer->dataBuffer) ? closedPointer[-1] - '0' : ESP8266_MAX_LINK_COUNT;
+        if (linkId < ESP8266_MAX_LINK_COUNT) {
+            linkTable[linkId].pendingReceiveLength = 0;
+        }
+        if (linkId < ESP8266_MAX_LINK_COUNT && isPassiveReceiveMode) {
+            dropPulledRequest(linkId);
+        }
+        if (linkId < ESP8266_MAX_LINK_COUNT &&
+            linkTable[linkId].type == ESP8266_LINK_STREAMING_BODY) {
+            abortRequestBody(context, linkId, REQUEST_BODY_ABORT_DISCONNECTED);
+        }
+        if (linkId < ESP8266_MAX_LINK_COUNT &&
+            linkTable[linkId].type == ESP8266_LINK_WEBSOCKET) {
+            closeWebSocketLink(context, linkId, true);
+        }
+        closedPointer[0] = ' ';    // mark as handled
+        closedPointer = findNotificationLine(closedPointer, LINK_CLOSED_STATUS, 1);
+    }
+}
+
+static char *findNotificationLine(char *searchStart, const char *notification, uint8_t linkIdLength) {   // "[<id>]<notification>" line outside +IPD payloads
+    char *dataBuffer = USARTInstance->RxBuffer->dataBuffer;
+    char *receivedDataEnd = dataBuffer + getStringRingBufferSize(USARTInstance->RxBuffer);
+    char *notificationPointer = (char *) findMarkerSWAR(searchStart, notification);
+    char *ipdPointer = findDataMarker(searchStart);
+    while (notificationPointer != NULL) {
+        if (ipdPointer != NULL && ipdPointer < notificationPointer) {   // client data can contain any text
+            char *dataEnd = skipReceivedData(ipdPointer);
+            if (dataEnd == NULL || dataEnd > receivedDataEnd) return NULL;  // rest of buffer is payload
+            if (dataEnd > notificationPointer) {
+                notificationPointer = (char *) findMarkerSWAR(dataEnd, notification);
+            }
+            ipdPointer = findDataMarker(dataEnd);
+            continue;
+        }
+
+        char *lineStart = notificationPointer - linkIdLength;
+        bool isLineStart = lineStart == dataBuffer || (lineStart > dataBuffer && lineStart[-1] == '\n');
+        for (uint8_t i = 0; i < linkIdLength && isLineStart; i++) {
+            isLineStart = lineStart[i] >= '0' && lineStart[i] <= '9';
+        }
+        if (isLineStart) return notificationPointer;
+        notificationPointer = (char *) findMarkerSWAR(notificationPointer + 1, notification);
+    }
+    return NULL;
+}
+
+static char *findDataMarker(char *searchStart) {
+    char *markerPointer = (char *) findMarkerSWAR(searchStart, DATA_MARKER_NAME);
+    while (markerPointer != NULL && (markerPointer == USARTInstance->RxBuffer->dataBuffer || (markerPointer[-1] != '+' && markerPointer[-1] != ' '))) {
+        markerPointer = (char *) findMarkerSWAR(markerPointer + 1, DATA_MARKER_NAME);
+    }
+    return (markerPointer != NULL) ? markerPointer - 1 : NULL;
+}
+
+static char *skipReceivedData(char *ipdPointer) {  // first byte after +IPD payload, NULL while marker is incomplete
+    const char *lineEnd = findByteSWAR(ipdPointer, '\r');
+    const char *dataStart = findByteSWAR(ipdPointer, ':');
+    if (dataStart != NULL && (lineEnd == NULL || dataStart < lineEnd)) {
+        return (char *) dataStart + 1 + strtoul(ipdPointer + ESP8266_IPD_MARKER_LENGTH_INDEX, NULL, 10);
+    }
+    return (char *) lineEnd;    // passive mode notification has no data
+}
+
+static void releaseProcessedRequest(ServerContext *context, bool isForced) {
+    bool havePendingRequests = findMarkerSWAR(USARTInstance->RxBuffer->dataPointer, DATA_RECEIVED_STATUS) != NULL;    // check for pending requests
+    if (!havePendingRequests || isForced) {  // shrink rx buffer if no new requests arrived
+        detectClosedLinks(context);
+        TRACE_EVENT(TRACE_RX_BUFFER_RELEASE, ESP8266_TRACE_NO_LINK, USARTInstance->RxBuffer->head);
+        LL_USART_DisableIT_RXNE(USARTInstance->USARTx);
+        clearStringRingBuffer(USARTInstance->RxBuffer, USARTInstance->RxBuffer->head);
+        LL_USART_EnableIT_RXNE(USARTInstance->USARTx);
+        memset(pendingRequests, 0, sizeof(pendingRequests));
+    }
+    idleRxLength = 0;   // buffer state changed, next pass inspects it again
+}
+
+static bool releaseHandledNotifications(ServerContext *context) {  // "<id>,CONNECT", "<id>,CLOSED" and station events only, no +IPD
+    StringRingBuffer *rxBuffer = USARTInstance->RxBuffer;
+    uint32_t receivedLength = getStringRingBufferSize(rxBuffer);
+    if (receivedLength == 0) return true;
+    if (rxBuffer->dataBuffer[receivedLength - 1] != '\n') return false;  // notification line is still arriving
+
+    detectStationEvents(context);
+    detectClosedLinks(context);
+    LL_USART_DisableIT_RXNE(USARTInstance->USARTx);
+    clearStringRingBuffer(rxBuffer, rxBuffer->head);
+    LL_USART_EnableIT_RXNE(USARTInstance->USARTx);
+    memset(pendingRequests, 0, sizeof(pendingRequests));
+    return true;
+}
+
+static char *selectPendingRequest(char *firstIpdPointer, uint8_t *backlogCount) {   // highest priority complete request, the oldest one on equal priority
+    static char pendingMarker[ESP8266_DATA_MARKER_MAX_LENGTH];
+    char *selectedPointer = NULL;
+    RoutePriority selectedPriority = ROUTE_PRIORITY_BULK;
+    uint8_t queuedLinks = 0;    // only the oldest request of each link can be served, pipelined responses keep their order
+    *backlogCount = 0;
+
+    char *ipdPointer = firstIpdPointer;
+    while (ipdPointer != NULL) {
+        memset(pendingMarker, 0, ESP8266_DATA_MARKER_MAX_LENGTH);
+        getIPDMarkerValue(ipdPointer, pendingMarker);
+        uint32_t markerLength = strlen(pendingMarker);
+        bool isDataMarker = markerLength > 0 && pendingMarker[markerLength - 1] == ':';   // passive mode notification carries no request
+        uint8_t linkId = pendingMarker[ESP8266_IPD_MARKER_REQUEST_ID_INDEX] - '0';
+        if (isDataMarker && linkId < ESP8266_MAX_LINK_COUNT && linkTable[linkId].type == ESP8266_LINK_TCP_SERVER) {
+            (*backlogCount)++;
+            bool isLinkQueued = (queuedLinks & (1 << linkId)) != 0;
+            queuedLinks |= (1 << linkId);
+
+            struct PendingRequest *pending = &pendingRequests[linkId];
+            if (!isLinkQueued && pending->ipdPointer != ipdPointer && isRequestHeaderReceived(ipdPointer, pendingMarker)) {
+                classifyPendingRequest(pending, ipdPointer + markerLength);
+                pending->ipdPointer = ipdPointer;
+            }
+            if (!isLinkQueued && pending->ipdPointer == ipdPointer &&
+                (ipdPointer == firstIpdPointer || pending->isReorderable) && (selectedPointer == NULL || pending->priority > selectedPriority)) {
+                selectedPointer = ipdPointer;
+                selectedPriority = pending->priority;
+            }
+        }
+        ipdPointer = (char *) findMarkerSWAR(ipdPointer + 1, DATA_RECEIVED_STATUS);
+    }
+    return (selectedPointer != NULL) ? selectedPointer : firstIpdPointer;   // nothing complete, wait for the oldest one
+}
+
+static bool isRequestHeaderReceived(char *ipdPointer, const char *ipdMarker) {
+    uint32_t markerLength = strlen(ipdMarker);
+    if (markerLength == 0 || ipdMarker[markerLength - 1] != ':') return false;
+    const char *payloadPointer = ipdPointer + markerLength;
+    const char *segmentEnd = payloadPointer + strtoul(&ipdMarker[ESP8266_IPD_MARKER_LENGTH_INDEX], NULL, 10);
+    const char *requestEndPointer = findMarkerSWAR(payloadPointer, REQUEST_END_MARKER);
+    return requestEndPointer != NULL && requestEndPointer + ESP8266_REQUEST_END_MARKER_LENGTH <= segmentEnd;  // end marker of this segment, not of the next request
+}
+
+static void classifyPendingRequest(struct PendingRequest *pending, const char *request) {   // from request line, HTTP parser keeps served request
+    pending->priority = ROUTE_PRIORITY_NORMAL;
+    pending->isReorderable = false;     // regex mappings and other methods are served in arrival order
+    for (uint8_t i = 0; i < INDEXED_METHOD_COUNT; i++) {
+        uint32_t methodLength = strlen(INDEXED_METHODS[i].name);
+        if (strncmp(request, INDEXED_METHODS[i].name, methodLength) == 0 && request[methodLength] == ' ') {
+            if (routeTableFind(routeTable, INDEXED_METHODS[i].method, &request[methodLength + 1], &pendingRouteMatch)) {
+                pending->priority = pendingRouteMatch.route->priority;
+                pending->isReorderable = pendingRouteMatch.route->attachment == NULL;  // upload and websocket routes read data after request in place
+            }
+            return;
+        }
+    }
+}
+
+static bool isRequestAdmitted(ServerContext *context, uint8_t backlogCount) {
+    RoutePriority priority = (routeMatch.route != NULL) ? routeMatch.route->priority : ROUTE_PRIORITY_NORMAL;
+    if (priority == ROUTE_PRIORITY_CONTROL) return true;
+    if (admissionBacklogLimit > 0 && backlogCount > admissionBacklogLimit) return false;
+    return takeClientToken(&context->requestIP);
+}
+
+static bool takeClientToken(const IPAddress *address) {
+    if (rateLimitPerSecond == 0 || isStringEmpty(address->octetsIPv4)) return true;  // passive mode data has no remote address
+    uint32_t nowMs = currentMilliSeconds();
+    uint32_t capacity = rateLimitBurstSize * RATE_LIMIT_TOKEN_SCALE;
+
+    struct ClientBucket *bucket = &clientBuckets[0];
+    for (uint8_t i = 0; i < ESP8266_RATE_LIMIT_CLIENT_COUNT; i++) {
+        if (isStringEquals(clientBuckets[i].address.octetsIPv4, address->octetsIPv4)) {
+            bucket = &clientBuckets[i];
             break;
         }
+        if (isStringNotBlank(bucket->address.octetsIPv4) &&
+            (isStringEmpty(clientBuckets[i].address.octetsIPv4) || nowMs - clientBuckets[i].lastRefillMs > nowMs - bucket->lastRefillMs)) {
+            bucket = &clientBuckets[i];    // free or least recently seen
+        }
+    }
+
+    if (isStringNotEquals(bucket->address.octetsIPv4, address->octetsIPv4)) {   // new client starts with full burst
+        bucket->address = *address;
+        bucket->tokens = capacity;
+    } else {
+        uint64_t refill = (uint64_t) (nowMs - bucket->lastRefillMs) * rateLimitPerSecond;
+        bucket->tokens = (bucket->tokens + refill > capacity) ? capacity : bucket->tokens + (uint32_t) refill;
+    }
+    bucket->lastRefillMs = nowMs;
 
-        byteCountInBuffer = getStringRingBufferSize(USARTInstance->RxBuffer);
-        if (isRxBufferNotEmptyUSART(USARTInstance)) {
-            delay_ms(1);
+    if (bucket->tokens < RATE_LIMIT_TOKEN_SCALE) return false;
+    bucket->tokens -= RATE_LIMIT_TOKEN_SCALE;
+    return true;
+}
 
-            if (byteCountInBuffer == getStringRingBufferSize(USARTInstance->RxBuffer)) { // check that no new data is arrived
-                if (isResponseOK(rxBufferPointer)) {
-                    return ESP8266_SERVER_SUCCESS;
-                } else if (isResponseError(rxBufferPointer)) {
-                    return ESP8266_SERVER_ERROR;
-                } else if (isRxBufferFullUSART(USARTInstance)) {
-                    return ESP8266_SERVER_ERROR_BUFFER_FULL;
-                }
+static void rejectRequest(ServerContext *context, uint8_t backlogCount) {
+    TRACE_EVENT(TRACE_REQUEST_REJECTED, context->socketId, backlogCount);
+    if (isOverloadCloseEnabled && admissionBacklogLimit > 0 && backlogCount > admissionBacklogLimit) {
+        closeConnectionESP8266(context, context->socketId, getCommandResponsePointer());   // overloaded, response would cost another CIPSEND
+        return;
+    }
+
+    HashMap headers = httpParser->headers;
+    hashMapClear(headers);
+    hashMapPut(headers, "Retry-After", RETRY_AFTER_SECONDS);
+    hashMapPut(headers, "Connection", "close");
+    sendServerResponseESP8266(context, HTTP_SERVICE_UNAVAILABLE, headers, NULL);
+}
+
+static void startListeningESP8266(ServerContext *context) {    // settings lost on module reset
+    sendNumericATCommand(context, "AT+CIPDINFO=", ESP8266_SHOW_REQUEST_IP_AND_PORT);    // show ip with +IPD
+    sendNumericATCommand(context, "AT+CIPMUX=", ESP8266_CONNECTION_MULTIPLE);
+    if (ESP8266_RESERVED_UDP_LINK_COUNT > 0) {  // keep highest link ids free from incoming TCP clients
+        sendNumericATCommand(context, "AT+CIPSERVERMAXCONN=", ESP8266_MAX_LINK_COUNT - ESP8266_RESERVED_UDP_LINK_COUNT);
+    }
+    ATCommand serverCommand = createATCommand(commandBuffer, COMMAND_MAX_LENGTH, "AT+CIPSERVER=");
+    appendATUnsigned(&serverCommand, ESP8266_CREATE_SERVER_MODE);
+    appendATLiteral(&serverCommand, ",");
+    appendATUnsigned(&serverCommand, context->configuration->serverPort);
+    sendATCommand(context, &serverCommand);
+
+    if (context->configuration->serverTimeoutMs <= ESP8266_MAX_ALLOWED_TIMEOUT) {
+        sendNumericATCommand(context, "AT+CIPSTO=", context->configuration->serverTimeoutMs);
+    }
+    if (isPassiveReceiveMode) {
+        sendNumericATCommand(context, "AT+CIPRECVMODE=", ESP8266_PASSIVE_RECEIVE_MODE);
+    }
+}
+
+static void superviseStationLink(ServerContext *context) {
+    StringRingBuffer *rxBuffer = USARTInstance->RxBuffer;
+    uint32_t receivedLength = getStringRingBufferSize(rxBuffer);
+    if (receivedLength > 0) {
+        detectStationEvents(context);
+    }
+
+    uint32_t checkPeriodMs = linkHealth.isConnected ? ESP8266_LINK_CHECK_PERIOD_MS : ESP8266_RECONNECT_PERIOD_MS;
+    if ((currentMilliSeconds() - lastLinkCheckMs) < checkPeriodMs && !isLinkCheckDue) return;
+    if (receivedLength > 0 && (rxBuffer->dataBuffer[receivedLength - 1] != '\n' ||
+                               findMarkerSWAR(rxBuffer->dataPointer, DATA_RECEIVED_STATUS) != NULL)) {
+        return;     // AT commands reuse rx buffer, wait until received data is processed
+    }
+    for (uint8_t linkId = 0; linkId < ESP8266_MAX_LINK_COUNT; linkId++) {
+        if (linkTable[linkId].type == ESP8266_LINK_STREAMING_BODY || linkTable[linkId].pendingReceiveLength > 0) return;
+    }
+
+    releaseProcessedRequest(context, true);    // only link events left, handle and drop them
+    if (isStationConnected(context)) {
+        if (!linkHealth.isConnected) {
+            restoreStationLink(context);    // module joined by itself after timed out join or lost event
+        }
+    } else {
+        markLinkLost();
+        reconnectStation(context);
+    }
+    releaseProcessedRequest(context, false);
+    lastLinkCheckMs = currentMilliSeconds();
+    isLinkCheckDue = false;
+}
+
+static void detectStationEvents(ServerContext *context) {  // unsolicited messages, link state is confirmed by AT+CIPSTATUS
+    char *eventPointer = findNotificationLine(USARTInstance->RxBuffer->dataBuffer, WIFI_EVENT_STATUS, 0);
+    while (eventPointer != NULL) {
+        char *eventName = eventPointer + strlen(WIFI_EVENT_STATUS);
+        if (strncmp(eventName, WIFI_DISCONNECT_EVENT, strlen(WIFI_DISCONNECT_EVENT)) == 0 ||
+            strncmp(eventName, WIFI_GOT_IP_EVENT, strlen(WIFI_GOT_IP_EVENT)) == 0) {
+            isLinkCheckDue = true;
+            eventPointer[0] = ' ';    // mark as handled
+        }
+        eventPointer = findNotificationLine(eventName, WIFI_EVENT_STATUS, 0);
+    }
+
+    char *readyPointer = findNotificationLine(USARTInstance->RxBuffer->dataBuffer, MODULE_READY_STATUS, 0);
+    if (readyPointer != NULL) {     // all connections and auto connect are gone after restart
+        readyPointer[0] = ' ';
+        for (uint8_t linkId = 0; linkId < ESP8266_MAX_LINK_COUNT; linkId++) {
+            if (linkTable[linkId].type == ESP8266_LINK_WEBSOCKET) {
+                closeWebSocketLink(context, linkId, true);
+            } else if (linkTable[linkId].type == ESP8266_LINK_STREAMING_BODY) {
+                abortRequestBody(context, linkId, REQUEST_BODY_ABORT_DISCONNECTED);
             }
+            memset(&linkTable[linkId], 0, sizeof(ESP8266Link));
         }
-        delay_ms(1);
+        markLinkLost();     // server must be restored even if station is joined again
+        isLinkCheckDue = true;
     }
+}
 
-    return status;
+static bool isStationConnected(ServerContext *context) {
+    if (sendBasicATCommand(context, "AT+CIPSTATUS") != ESP8266_SERVER_SUCCESS) {
+        return false;     // module is not responding, try to join again
+    }
+
+    const char *statusPointer = findMarkerSWAR(USARTInstance->RxBuffer->dataPointer, STATION_STATUS);
+    return statusPointer == NULL || strtoul(statusPointer + strlen(STATION_STATUS), NULL, 10) != ESP8266_STATION_NOT_CONNECTED;
 }
 
-static inline bool isResponseOK(char *responseBody) {
-    return strstr(responseBody, OK_STATUS) ||
-           strstr(responseBody, CLOSED_STATUS) ||
-           strstr(responseBody, READY_TO_RECEIVE_DATA);
+static void reconnectStation(ServerContext *context) {
+    ATCommand joinCommand = createATCommand(commandBuffer, COMMAND_MAX_LENGTH, "AT+CWJAP_CUR=");
+    appendATQuotedString(&joinCommand, stationSsid);
+    appendATLiteral(&joinCommand, ",");
+    appendATQuotedString(&joinCommand, stationPassword);
+    if (linkHealth.bssid[0] != '\0') {   // join known access point without searching for strongest one
+        appendATLiteral(&joinCommand, ",");
+        appendATQuotedString(&joinCommand, linkHealth.bssid);
+    }
+
+    if (sendATCommandAttempts(context, &joinCommand, 1) != ESP8266_SERVER_SUCCESS) {   // no resend, next attempt is after reconnect period
+        memset(linkHealth.bssid, 0, sizeof(linkHealth.bssid));    // access point can be replaced, next attempt is full join
+        return;
+    }
+    restoreStationLink(context);
 }
 
-static inline bool isResponseError(char *responseBody) {    // find for "error" or "fail" response status
-    return strstr(responseBody, ERROR_STATUS) ||
-           strstr(responseBody, FAIL_STATUS) ||
-           strstr(responseBody, SEND_FAIL_STATUS);
+static void restoreStationLink(ServerContext *context) {     // after own join and after module joined by itself
+    cacheJoinedAccessPoint(context);
+    if (sendBasicATCommand(context, "AT+CIPMUX?") == ESP8266_SERVER_SUCCESS &&
+        findMarkerSWAR(USARTInstance->RxBuffer->dataPointer, "+CIPMUX:1") == NULL) {  // server is gone only after module reset
+        startListeningESP8266(context);
+        linkHealth.serverRestoreCount++;
+    }
+    markLinkRestored();
+    linkHealth.reconnectCount++;
 }
 
-static inline bool isSsidValid(char *ssid) {
-    return (isStringNotBlank(ssid) && strlen(ssid) < ESP8266_MAX_SSID_LENGTH);
+static void cacheJoinedAccessPoint(ServerContext *context) {    // +CWJAP_CUR:<ssid>,"<bssid>",<channel>,<rssi>
+    if (sendBasicATCommand(context, "AT+CWJAP_CUR?") != ESP8266_SERVER_SUCCESS) return;
+    const char *responsePointer = findMarkerSWAR(USARTInstance->RxBuffer->dataPointer, JOINED_AP_STATUS);
+    const char *lineEnd = (responsePointer != NULL) ? findByteSWAR(responsePointer, '\r') : NULL;
+    if (lineEnd == NULL) return;
+
+    const char *separatorPointer = lineEnd;     // parsed from the end, ssid can contain any characters
+    for (uint8_t separatorCount = 0; separatorCount < 2 && separatorPointer > responsePointer;) {
+        separatorPointer--;
+        if (*separatorPointer == ',') separatorCount++;
+    }
+    const char *bssidPointer = separatorPointer - ESP8266_BSSID_LENGTH - 1;
+    if (bssidPointer <= responsePointer || bssidPointer[-1] != '"' || separatorPointer[-1] != '"') return;
+
+    memcpy(linkHealth.bssid, bssidPointer, ESP8266_BSSID_LENGTH);
+    linkHealth.bssid[ESP8266_BSSID_LENGTH] = '\0';
 }
 
-static inline bool isPasswordValid(char *password) {
-    return (isStringNotBlank(password) && strlen(password) < ESP8266_MAX_PASSWORD_LENGTH);
+static void markLinkLost() {
+    if (!linkHealth.isConnected) return;
+    linkHealth.isConnected = false;
+    linkHealth.disconnectedAtMs = currentMilliSeconds();
+}
+
+static void markLinkRestored() {
+    if (linkHealth.isConnected) return;
+    linkHealth.isConnected = true;
+    linkHealth.lastOutageMs = currentMilliSeconds() - linkHealth.disconnectedAtMs;
+    linkHealth.totalOutageMs += linkHealth.lastOutageMs;
+}
+
+static void pullPendingLinkData(ServerContext *context) {
+    StringRingBuffer *rxBuffer = USARTInstance->RxBuffer;
+    collectReceiveNotifications();
+    char *ipdPointer = (char *) findMarkerSWAR(rxBuffer->dataPointer, DATA_RECEIVED_STATUS);
+    isPullDeferred = ipdPointer != NULL;
+    if (isPullDeferred) {
+        extendPulledRequest(context, ipdPointer);    // previously pulled data is not processed yet, its header can continue in module
+        return;
+    }
+
+    if (!releaseHandledNotifications(context)) return;  // pull into empty buffer
+
+    if (rxBuffer->maxSize <= ESP8266_PULL_RESPONSE_RESERVE) return;
+    uint32_t freeSpace = rxBuffer->maxSize - ESP8266_PULL_RESPONSE_RESERVE;
+    for (uint8_t i = 0; i < ESP8266_MAX_LINK_COUNT; i++) {
+        uint8_t linkId = (nextPullLinkId + i) % ESP8266_MAX_LINK_COUNT;
+        uint32_t pendingLength = linkTable[linkId].pendingReceiveLength;
+        if (pendingLength > 0) {
+            nextPullLinkId = (linkId + 1) % ESP8266_MAX_LINK_COUNT;
+            pullReceivedData(context, linkId, pendingLength < freeSpace ? pendingLength : freeSpace);
+            return;
+        }
+    }
+}
+
+static void collectReceiveNotifications() {  // passive mode "+IPD,<id>,<len>\r\n", without data
+    char *receivedDataEnd = USARTInstance->RxBuffer->dataBuffer + getStringRingBufferSize(USARTInstance->RxBuffer);
+    char *notificationPointer = (char *) findMarkerSWAR(USARTInstance->RxBuffer->dataPointer, DATA_RECEIVED_STATUS);
+    while (notificationPointer != NULL) {
+        char *linkIdEnd;
+        uint32_t linkId = strtoul(notificationPointer + strlen(DATA_RECEIVED_STATUS), &linkIdEnd, 10);
+        uint32_t pendingLength = strtoul(linkIdEnd + 1, NULL, 10);
+        const char *lineEnd = findByteSWAR(linkIdEnd, '\r');
+        const char *dataStart = findByteSWAR(linkIdEnd, ':');
+        if (*linkIdEnd != ',' || (lineEnd == NULL && dataStart == NULL)) return;   // incomplete notification
+
+        if (dataStart != NULL && (lineEnd == NULL || dataStart < lineEnd)) {    // pulled data, payload can contain any text
+            char *payloadEnd = (char *) dataStart + 1 + pendingLength;
+            if (payloadEnd > receivedDataEnd) return;
+            notificationPointer = (char *) findMarkerSWAR(payloadEnd, DATA_RECEIVED_STATUS);
+            continue;
+        }
+
+        if (linkId < ESP8266_MAX_LINK_COUNT) {
+            linkTable[linkId].pendingReceiveLength = pendingLength;    // total length buffered by module
+        }
+        notificationPointer[0] = ' ';    // mark as handled
+        notificationPointer = (char *) findMarkerSWAR(lineEnd, DATA_RECEIVED_STATUS);
+    }
+}
+
+static char *pullReceivedData(ServerContext *context, uint8_t linkId, uint32_t length) {  // returns rewritten +IPD marker
+    char *commandResponsePointer = getCommandResponsePointer();
+    ATCommand pullCommand = createATCommand(commandBuffer, COMMAND_MAX_LENGTH, "AT+CIPRECVDATA=");
+    appendATUnsigned(&pullCommand, linkId);
+    appendATLiteral(&pullCommand, ",");
+    appendATUnsigned(&pullCommand, length);
+    finishATCommand(&pullCommand);
+    TRACE_EVENT(TRACE_AT_COMMAND, linkId, pullCommand.length);
+    sendDataUSART(USARTInstance, pullCommand.buffer, pullCommand.length);
+
+    uint32_t startTimeMillis = currentMilliSeconds();
+    ResponseMatcher matcher;
+    resetResponseMatcher(&matcher, commandResponsePointer);
+    while ((currentMilliSeconds() - startTimeMillis) < context->configuration->serverTimeoutMs) {
+        char *receivedDataEnd = USARTInstance->RxBuffer->dataBuffer + getStringRingBufferSize(USARTInstance->RxBuffer);
+        char *pulledDataPointer = (char *) findMarkerSWAR(commandResponsePointer, DATA_PULLED_STATUS);
+
+        if (pulledDataPointer == NULL) {
+            if ((feedResponseMatcher(&matcher, receivedDataEnd) & RESPONSE_STATUS_FAILURE_MASK) || isRxBufferFullUSART(USARTInstance)) {
+                break;  // link closed before pull
+            }
+            waitForReceivedData(context, receivedDataEnd, startTimeMillis);
+            continue;
+        }
+
+        char *lengthPointer = pulledDataPointer + strlen(DATA_PULLED_STATUS);
+        char *lengthEnd;
+        uint32_t pulledLength = strtoul(lengthPointer, &lengthEnd, 10);
+        char *payloadPointer = (char *) findByteSWAR(lengthEnd, ':');   // optional ",<ip>,<port>" before data
+        if (lengthEnd == lengthPointer || payloadPointer == NULL || (uint32_t) (receivedDataEnd - payloadPointer - 1) < pulledLength) {
+            if (isRxBufferFullUSART(USARTInstance)) break;
+            waitForReceivedData(context, receivedDataEnd, startTimeMillis);
+            continue;
+        }
+
+        // Rewrite "+CIPRECVDATA,<len>" to active mode "+IPD,<id>,<len>" in place, prefix is always longer
+        char *markerPointer = lengthPointer - ESP8266_IPD_MARKER_LENGTH_INDEX;
+        memset(commandResponsePointer, ' ', markerPointer - commandResponsePointer);    // hide command echo
+        memcpy(markerPointer, DATA_RECEIVED_STATUS, strlen(DATA_RECEIVED_STATUS));
+        markerPointer[ESP8266_IPD_MARKER_REQUEST_ID_INDEX] = (char) ('0' + linkId);
+        markerPointer[ESP8266_IPD_MARKER_REQUEST_ID_INDEX + 1] = ',';
+
+        uint32_t pendingLength = linkTable[linkId].pendingReceiveLength;
+        linkTable[linkId].pendingReceiveLength = (pulledLength < pendingLength) ? pendingLength - pulledLength : 0;
+        return markerPointer;
+    }
+    linkTable[linkId].pendingReceiveLength = 0;     // resynchronized by next notification
+    return NULL;
+}
+
+static void extendPulledRequest(ServerContext *context, char *ipdPointer) {
+    static char pulledMarker[ESP8266_DATA_MARKER_MAX_LENGTH];
+    memset(pulledMarker, 0, ESP8266_DATA_MARKER_MAX_LENGTH);
+    getIPDMarkerValue(ipdPointer, pulledMarker);
+    uint32_t markerLength = strlen(pulledMarker);
+    uint8_t linkId = pulledMarker[ESP8266_IPD_MARKER_REQUEST_ID_INDEX] - '0';
+    if (markerLength == 0 || pulledMarker[markerLength - 1] != ':' || linkId >= ESP8266_MAX_LINK_COUNT ||
+        linkTable[linkId].type != ESP8266_LINK_TCP_SERVER || isRequestHeaderReceived(ipdPointer, pulledMarker)) {
+        return;     // not a request header or complete one
+    }
+
+    StringRingBuffer *rxBuffer = USARTInstance->RxBuffer;
+    uint32_t usedSpace = getStringRingBufferSize(rxBuffer) + ESP8266_PULL_RESPONSE_RESERVE;
+    if (usedSpace >= rxBuffer->maxSize) {
+        rejectOversizedRequest(context, linkId, ipdPointer);
+        return;
+    }
+    uint32_t pendingLength = linkTable[linkId].pendingReceiveLength;
+    if (pendingLength == 0) return;     // rest of header is not received by module yet, wait for notification
+
+    uint32_t freeSpace = rxBuffer->maxSize - usedSpace;
+    char *nextIpdPointer = pullReceivedData(context, linkId, pendingLength < freeSpace ? pendingLength : freeSpace);
+    if (nextIpdPointer == NULL) return;
+    collectReceiveNotifications();  // notifications between pulls are overwritten when segments are joined
+    if (!joinPulledSegment(ipdPointer, pulledMarker, nextIpdPointer)) {
+        rejectOversizedRequest(context, linkId, ipdPointer);
+    }
+}
+
+static bool joinPulledSegment(char *ipdPointer, const char *ipdMarker, char *nextIpdPointer) {  // appends next pulled data to segment, marker is rewritten with total length
+    static char nextMarker[ESP8266_DATA_MARKER_MAX_LENGTH];
+    static char joinedMarker[ESP8266_DATA_MARKER_MAX_LENGTH];
+    memset(nextMarker, 0, ESP8266_DATA_MARKER_MAX_LENGTH);
+    getIPDMarkerValue(nextIpdPointer, nextMarker);
+    char *dataStart = ipdPointer + strlen(ipdMarker);
+    char *nextDataStart = nextIpdPointer + strlen(nextMarker);
+    char *lengthEnd;
+    uint32_t dataLength = strtoul(&ipdMarker[ESP8266_IPD_MARKER_LENGTH_INDEX], &lengthEnd, 10);
+    uint32_t nextDataLength = strtoul(&nextMarker[ESP8266_IPD_MARKER_LENGTH_INDEX], NULL, 10);
+
+    memcpy(joinedMarker, ipdMarker, ESP8266_IPD_MARKER_LENGTH_INDEX);   // "+IPD,<id>," then total length and optional ",<ip>,<port>:"
+    uint32_t joinedLength = ESP8266_IPD_MARKER_LENGTH_INDEX + formatUnsignedDecimal(&joinedMarker[ESP8266_IPD_MARKER_LENGTH_INDEX], dataLength + nextDataLength);
+    if (joinedLength + strlen(lengthEnd) >= ESP8266_DATA_MARKER_MAX_LENGTH) return false;
+    strcpy(&joinedMarker[joinedLength], lengthEnd);
+    joinedLength += strlen(lengthEnd);
+
+    char *joinedPointer = dataStart - joinedLength;     // longer marker grows into blanked command echo before it
+    if (joinedPointer < USARTInstance->RxBuffer->dataPointer) return false;
+    memcpy(joinedPointer, joinedMarker, joinedLength);
+    memmove(dataStart + dataLength, nextDataStart, nextDataLength);     // over OK of previous response and prefix of next one
+    memset(dataStart + dataLength + nextDataLength, ' ', nextDataStart - (dataStart + dataLength));
+    return true;
+}
+
+static void dropPulledRequest(uint8_t linkId) {    // incomplete header of closed link would block next pulls
+    static char pulledMarker[ESP8266_DATA_MARKER_MAX_LENGTH];
+    char *ipdPointer = (char *) findMarkerSWAR(USARTInstance->RxBuffer->dataPointer, DATA_RECEIVED_STATUS);
+    if (ipdPointer == NULL || ipdPointer[ESP8266_IPD_MARKER_REQUEST_ID_INDEX] - '0' != linkId) return;
+    memset(pulledMarker, 0, ESP8266_DATA_MARKER_MAX_LENGTH);
+    getIPDMarkerValue(ipdPointer, pulledMarker);
+    if (linkTable[linkId].type == ESP8266_LINK_TCP_SERVER && !isRequestHeaderReceived(ipdPointer, pulledMarker)) {
+        ipdPointer[0] = ' ';    // mark as handled
+    }
+}
+
+static void rejectOversizedRequest(ServerContext *context, uint8_t linkId, char *ipdPointer) {  // header can't fit rx buffer
+    context->socketId = linkId;
+    linkTable[linkId].pendingReceiveLength = 0;     // dropped by module with closed link
+    ipdPointer[0] = ' ';    // mark as handled
+    HashMap headers = httpParser->headers;
+    hashMapClear(headers);
+    hashMapPut(headers, "Connection", "close");
+    sendServerResponseESP8266(context, HTTP_PAYLOAD_TOO_LARGE, headers, NULL);
+    releaseProcessedRequest(context, true);
+}
+
+static char *getCommandResponsePointer() {  // AT command responses are read after all received data
+    uint32_t bytesInRxBuffer = (USARTInstance->RxBuffer->dataPointer - USARTInstance->RxBuffer->dataBuffer);
+    return USARTInstance->RxBuffer->dataPointer + (USARTInstance->RxBuffer->head - bytesInRxBuffer);
+}
+
+static RequestHandlerFunction resolveRequestHandler(ServerContext *context) {
+    if (routeTableFind(routeTable, httpParser->method, httpParser->uriPath, &routeMatch)) {  // exact and path variable routes first
+        return routeMatch.route->handler;
+    }
+    return handleIncomingServerRequest(context, httpParser);    // fallback to regex URL mappings
+}
+
+static RequestHandlerFunction resolveIndexedRequestHandler() {   // NULL when method is not indexed or request needs regex mappings
+    const char *methodName = &requestIndex.request[requestIndex.method.offset];
+    for (uint8_t i = 0; i < INDEXED_METHOD_COUNT; i++) {
+        const struct IndexedMethod *indexedMethod = &INDEXED_METHODS[i];
+        if (strlen(indexedMethod->name) == requestIndex.method.length &&
+            strncmp(methodName, indexedMethod->name, requestIndex.method.length) == 0) {
+            bool isFound = routeTableFind(routeTable, indexedMethod->method, &requestIndex.request[requestIndex.path.offset], &routeMatch);
+            httpParser->method = indexedMethod->method;
+            return isFound ? routeMatch.route->handler : NULL;
+        }
+    }
+    return NULL;
+}
+
+static bool isChunkedResponseAccepted() {
+    if (requestIndex.isValid) {
+        return requestIndex.version.length == strlen(SERVER_HTTP_VERSION) &&
+               strncmp(&requestIndex.request[requestIndex.version.offset], SERVER_HTTP_VERSION, requestIndex.version.length) == 0;
+    }
+    return isStringEquals(httpParser->httpVersion, SERVER_HTTP_VERSION);
+}
+
+static const char *copyMapValue(HashMap map, const char *name, char *valueBuffer, uint32_t bufferSize) {  // copy is truncated to buffer size
+    const char *value = hashMapGet(map, name);
+    if (value == NULL || bufferSize == 0) return NULL;
+    uint32_t length = strlen(value);
+    uint32_t copyLength = (length < bufferSize) ? length : bufferSize - 1;
+    memcpy(valueBuffer, value, copyLength);
+    valueBuffer[copyLength] = '\0';
+    return value;
 }
 
 static void getIPDMarkerValue(char *rawRequest, char *valueBuffer) {
     char *dataMarker = rawRequest;
     uint8_t markerCounter = 0;
-    while (*dataMarker != '\0' && markerCounter < ESP8266_DATA_MARKER_MAX_LENGTH) {
+    while (*dataMarker != '\0' && *dataMarker != '\r' && markerCounter < ESP8266_DATA_MARKER_MAX_LENGTH - 1) {  // notification without data ends at line end
         if (*dataMarker == ':') {
             valueBuffer[markerCounter] = *dataMarker;
             break;
@@ -303,109 +1596,149 @@ static IPAddress parseRequestIPAddress(char *requestPointer) {
 
     char *nextPointer;
     char *token = splitStringReentrant(ipAddressBuffer, ",", &nextPointer);
-    for (int i = 0; i < 2; i++) {// skip request id and size
+    for (int i = 0; i < 2 && token != NULL; i++) {// skip request id and size
         token = splitStringReentrant(NULL, ",", &nextPointer);
     }
+    if (token == NULL) {    // passive mode data without remote address
+        IPAddress emptyAddress = {0};
+        return emptyAddress;
+    }
     return ipAddressFromString(token);
 }
 
-static ESP8266ServerStatus sendSingleResponse(ServerContext *context, HashMap headers, const char *body, uint32_t bodyLength, char *commandResponsePointer) {
-    char dataLengthBuffer[sizeof(uint32_t) * 8 + 1] = {0};    // u32 max length
-    sprintf(dataLengthBuffer, "%lu", bodyLength);
-    hashMapPut(headers, "Content-Length", dataLengthBuffer);
-
-    formatHTTPServerHeaders(context->txDataBufferPointer, headers);
-    formatHTTPServerResponseBody(context, body);
-
-    uint32_t totalResponseLength = strlen(context->txDataBufferPointer);
-    USARTInstance->TxBuffer->tail = 0;
-    USARTInstance->TxBuffer->head = totalResponseLength;
-    ESP8266ServerStatus responseSendStatus = sendHTTPResponseESP8266(context, totalResponseLength, commandResponsePointer);
-    if (responseSendStatus != ESP8266_SERVER_SUCCESS) {
-        closeConnectionESP8266(context, ESP8266_ALL_CONNECTIONS_ID, commandResponsePointer);
-        return responseSendStatus;
+static void flushResponseSegment(ServerContext *context) {
+    closeResponseChunk(context->txDataBufferPointer);
+    responseSegmenter.status = sendTxBufferESP8266(context, responseSegmenter.linkId, responseSegmenter.length, responseSegmenter.commandResponsePointer);
+    responseSegmenter.length = 0;
+    if (responseSegmenter.status != ESP8266_SERVER_SUCCESS) {
+        closeConnectionESP8266(context, ESP8266_ALL_CONNECTIONS_ID, responseSegmenter.commandResponsePointer);
     }
-    return responseSendStatus;
 }
 
-static ESP8266ServerStatus sendChunkedResponse(ServerContext *context, HashMap headers, const char *body, uint32_t bodyLength, char *commandResponsePointer) {
-    hashMapRemove(headers, "Content-Length");   // removing content length header for chunked response if present
-    hashMapPut(headers, "Transfer-Encoding", "chunked");
-    formatHTTPServerHeaders(context->txDataBufferPointer, headers);
+static void flushActiveResponse(ServerContext *context) {   // other senders reuse TX buffer, pending response part is sent first
+    if (responseSegmenter.isActive && responseSegmenter.length > 0 && responseSegmenter.status == ESP8266_SERVER_SUCCESS) {
+        flushResponseSegment(context);
+    }
+}
 
-    uint32_t totalResponseLength = strlen(context->txDataBufferPointer);
-    USARTInstance->TxBuffer->tail = 0;
-    USARTInstance->TxBuffer->head = totalResponseLength;
-    ESP8266ServerStatus responseSendStatus = sendHTTPResponseESP8266(context, totalResponseLength, commandResponsePointer);
-    if (responseSendStatus != ESP8266_SERVER_SUCCESS) {
-        closeConnectionESP8266(context, ESP8266_ALL_CONNECTIONS_ID, commandResponsePointer);
-        return responseSendStatus;
+static void closeResponseChunk(char *txBuffer) {  // fill reserved "XXX\r\n" field and append chunk end
+    if (!responseSegmenter.isChunkOpen) return;
+    uint32_t chunkLength = responseSegmenter.length - responseSegmenter.chunkStart - ESP8266_CHUNK_SIZE_FIELD_LENGTH;
+    char *sizeField = &txBuffer[responseSegmenter.chunkStart];
+    for (int8_t i = ESP8266_CHUNK_SIZE_DIGITS - 1; i >= 0; i--) {   // zero padded hex size
+        sizeField[i] = "0123456789ABCDEF"[chunkLength & 0x0F];
+        chunkLength >>= 4;
     }
+    memcpy(&sizeField[ESP8266_CHUNK_SIZE_DIGITS], NEW_LINE, 2);
+    memcpy(&txBuffer[responseSegmenter.length], NEW_LINE, 2);
+    responseSegmenter.length += ESP8266_CHUNK_END_LENGTH;
+    responseSegmenter.isChunkOpen = false;
+}
 
-    ChunkedResponse chunkedResponse = prepareChunkedResponse(ESP8266_INNER_TX_BUFFER_SIZE, body, bodyLength);
-    while (hasNextHTTPChunk(&chunkedResponse, context->txDataBufferPointer)) {
-        totalResponseLength = strlen(context->txDataBufferPointer);
+static ESP8266ServerStatus writeTemplateSlot(ServerContext *context, const TemplateSegment *segment, const char *value) {
+    if (value == NULL) value = "";
+    uint32_t valueLength = strlen(value);
+    if (segment->length == 0) {
+        return writeResponseStreamESP8266(context, value, valueLength);
+    }
 
-        USARTInstance->TxBuffer->tail = 0;
-        USARTInstance->TxBuffer->head = totalResponseLength;
-        responseSendStatus = sendHTTPResponseESP8266(context, totalResponseLength, commandResponsePointer);
-        if (responseSendStatus != ESP8266_SERVER_SUCCESS) {
-            closeConnectionESP8266(context, ESP8266_ALL_CONNECTIONS_ID, commandResponsePointer);
-            return responseSendStatus;
-        }
+    if (valueLength > segment->length) valueLength = segment->length;  // cut to keep precomputed Content-Length
+    ESP8266ServerStatus serverStatus = writeResponseStreamESP8266(context, value, valueLength);
+    uint32_t paddingLength = segment->length - valueLength;
+    while (paddingLength > 0 && serverStatus == ESP8266_SERVER_SUCCESS) {
+        uint32_t length = paddingLength < TEMPLATE_PADDING_LENGTH ? paddingLength : TEMPLATE_PADDING_LENGTH;
+        serverStatus = writeResponseStreamESP8266(context, TEMPLATE_PADDING, length);
+        paddingLength -= length;
     }
-    return responseSendStatus;
+    return serverStatus;
 }
 
-static ESP8266ServerStatus sendHTTPResponseESP8266(ServerContext *context, uint32_t dataLength, char *commandResponsePointer) {
+static ESP8266ServerStatus sendTxBufferESP8266(ServerContext *context, uint32_t linkId, uint32_t dataLength, char *commandResponsePointer) {
+    StringRingBuffer *txBuffer = USARTInstance->TxBuffer;
+    txBuffer->tail = 0;
+    txBuffer->head = dataLength % txBuffer->maxSize;
+    txBuffer->isFull = (dataLength == txBuffer->maxSize);   // full segment wraps head back to zero
+    return sendHTTPResponseESP8266(context, linkId, dataLength, commandResponsePointer);
+}
+
+static ESP8266ServerStatus sendHTTPResponseESP8266(ServerContext *context, uint32_t linkId, uint32_t dataLength, char *commandResponsePointer) {
     StringRingBuffer *txBufferPointer = USARTInstance->TxBuffer; // save base tx buffer
     USARTInstance->TxBuffer = tmpTxBuffer;  // set tmp tx buffer for command sending
 
-    LL_USART_DisableIT_RXNE(USARTInstance->USARTx); // turn off receiver while data transmission
-    memset(commandBuffer, 0, COMMAND_MAX_LENGTH);
-    sprintf(commandBuffer, "AT+CIPSEND=%lu,%lu\r\n", context->socketId, dataLength);
-    sendStringUSART(USARTInstance, commandBuffer);
+    if (!isPassiveReceiveMode) {
+        LL_USART_DisableIT_RXNE(USARTInstance->USARTx); // turn off receiver while data transmission
+    }
+    ATCommand sendCommand = createATCommand(commandBuffer, COMMAND_MAX_LENGTH, "AT+CIPSEND=");
+    appendATUnsigned(&sendCommand, linkId);
+    appendATLiteral(&sendCommand, ",");
+    appendATUnsigned(&sendCommand, dataLength);
+    finishATCommand(&sendCommand);
+    TRACE_EVENT(TRACE_CIPSEND, linkId, dataLength);
+    sendDataUSART(USARTInstance, sendCommand.buffer, sendCommand.length);
     while (isStringRingBufferNotEmpty(USARTInstance->TxBuffer));
     LL_USART_EnableIT_RXNE(USARTInstance->USARTx);  // data is sent, enable receiver
-    ESP8266ServerStatus serverStatus = readCommandResponse(context, commandResponsePointer);
+    ESP8266ServerStatus serverStatus = readCommandResponse(context, commandResponsePointer, RESPONSE_STATUS_READY);    // "OK" precedes the prompt
+    TRACE_EVENT(TRACE_SEND_PROMPT, linkId, serverStatus);
 
     if (serverStatus == ESP8266_SERVER_SUCCESS) { // check that module ready to receive data
-        LL_USART_DisableIT_RXNE(USARTInstance->USARTx); // disable receiver while data send, preventing deadlock
+        if (!isPassiveReceiveMode) {    // passive mode receives only short notifications, collected below
+            LL_USART_DisableIT_RXNE(USARTInstance->USARTx); // disable receiver while data send, preventing deadlock
+        }
         USARTInstance->TxBuffer = txBufferPointer;    // return already formatted response buffer
         LL_USART_EnableIT_TXE(USARTInstance->USARTx);   // transmit response data
         while (isStringRingBufferNotEmpty(USARTInstance->TxBuffer));    // wait until all data is sent
         LL_USART_EnableIT_RXNE(USARTInstance->USARTx);  // data is sent, enable receiver
 
-        uint32_t startTimeMillis = currentMilliSeconds();
-        while (!strstr(commandResponsePointer, SEND_OK_STATUS)) {  // wait for data send
-            if ((currentMilliSeconds() - startTimeMillis) >= context->configuration->serverTimeoutMs) {
-                serverStatus = ESP8266_SERVER_TIMEOUT;
-                break;
-            }
-
-            if (strstr(commandResponsePointer, SEND_FAIL_STATUS) ||
-                strstr(commandResponsePointer, ERROR_STATUS)) {// new request can occur while response send and close previous connection
-                serverStatus = ESP8266_SERVER_ERROR;
-                break;
-            }
-            delay_ms(1);
+        serverStatus = readCommandResponse(context, commandResponsePointer, RESPONSE_STATUS_SEND_OK);  // wait for data send, new request can close previous connection
+        if (serverStatus == ESP8266_SERVER_SUCCESS) {
+            TRACE_EVENT(TRACE_SEND_OK, linkId, dataLength);
+        } else {
+            TRACE_EVENT(TRACE_SEND_FAIL, linkId, serverStatus);
         }
     }
 
+    LL_USART_DisableIT_RXNE(USARTInstance->USARTx);
     uint32_t commandResponseLength = strlen(commandResponsePointer);
-    memset(commandResponsePointer, 0, commandResponseLength);
-    USARTInstance->RxBuffer->head -= commandResponseLength;
+    uint32_t keptLength = 0;
+    if (isPassiveReceiveMode) {     // receiver stays enabled, "+IPD,<id>,<len>" can arrive during exchange
+        collectReceiveNotifications();
+        const char *lineEnd = strrchr(commandResponsePointer, '\n');
+        keptLength = (lineEnd != NULL) ? (commandResponsePointer + commandResponseLength) - (lineEnd + 1) : commandResponseLength;
+        memmove(commandResponsePointer, commandResponsePointer + commandResponseLength - keptLength, keptLength);  // line is still arriving
+    }
+    memset(commandResponsePointer + keptLength, 0, commandResponseLength - keptLength);
+    USARTInstance->RxBuffer->head -= commandResponseLength - keptLength;
+    LL_USART_EnableIT_RXNE(USARTInstance->USARTx);
     USARTInstance->TxBuffer = txBufferPointer;
     return serverStatus;
 }
 
 static void closeConnectionESP8266(ServerContext *context, uint32_t connectionId, char *commandResponsePointer) {
-    memset(commandBuffer, 0, COMMAND_MAX_LENGTH);
-    sprintf(commandBuffer, "AT+CIPCLOSE=%lu\r\n", connectionId);
+    flushActiveResponse(context);
+    ATCommand closeCommand = createATCommand(commandBuffer, COMMAND_MAX_LENGTH, "AT+CIPCLOSE=");
+    appendATUnsigned(&closeCommand, connectionId);
+    finishATCommand(&closeCommand);
+    TRACE_EVENT(TRACE_AT_COMMAND, connectionId, closeCommand.length);
 
     LL_USART_DisableIT_RXNE(USARTInstance->USARTx);
-    sendStringUSART(USARTInstance, commandBuffer);
+    sendDataUSART(USARTInstance, closeCommand.buffer, closeCommand.length);
     while (isStringRingBufferNotEmpty(USARTInstance->TxBuffer));
     LL_USART_EnableIT_RXNE(USARTInstance->USARTx);
-    readCommandResponse(context, commandResponsePointer);
-}
\ No newline at end of file
+    readCommandResponse(context, commandResponsePointer, RESPONSE_STATUS_SUCCESS_MASK);
+}
+
+#if ESP8266_TRACE_ENABLED
+static void handleTraceDump(ServerContext *context, HTTPParser *request) {
+    HashMap headers = request->headers;
+    hashMapClear(headers);
+    hashMapPut(headers, "Content-Type", "application/octet-stream");
+    hashMapPut(headers, "Connection", "close");
+
+    isTracePaused = true;   // events of this response would overwrite ring while it is sent
+    if (beginResponseStreamESP8266(context, HTTP_OK, headers, sizeof(TraceRing)) == ESP8266_SERVER_SUCCESS) {
+        writeResponseStreamESP8266(context, (const char *) &traceRing, sizeof(TraceRing));
+        endResponseStreamESP8266(context);
+    }
+    isTracePaused = false;
+}
+#endif
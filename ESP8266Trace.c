@@ -0,0 +1,20 @@
+#include "ESP8266Trace.h"
+
+#if ESP8266_TRACE_ENABLED
+
+TraceRing traceRing = {
+        .magic = ESP8266_TRACE_MAGIC,
+        .version = ESP8266_TRACE_VERSION,
+        .eventCount = ESP8266_TRACE_EVENT_COUNT,
+        .coreClockHz = 0,
+        .head = 0
+};
+
+volatile bool isTracePaused = false;
+
+void initTraceESP8266() {
+    traceRing.coreClockHz = SystemCoreClock;   // decoder converts cycles to time
+    traceRing.head = 0;
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include "MarkerScanner.h"
+
+#define SWAR_ONES 0x01010101u
+#define SWAR_HIGHS 0x80808080u
+#define SWAR_WORD_SIZE sizeof(uint32_t)
+
+#define SWAR_HAS_ZERO(word) (((word) - SWAR_ONES) & ~(word) & SWAR_HIGHS)
+#define SWAR_HAS_BYTE(word, pattern) SWAR_HAS_ZERO((word) ^ (pattern))
+
+static inline uint32_t loadWord(const char *data);
+static inline bool isLineEquals(const char *line, uint32_t length, const char *value, uint32_t valueLength);
+
+
+const char *findByteSWAR(const char *data, char value) {
+    while (((uintptr_t) data & (SWAR_WORD_SIZE - 1)) != 0) { // byte steps until word aligned
+        if (*data == value) return data;
+        if (*data == '\0') return NULL;
+        data++;
+    }
+
+    uint32_t pattern = SWAR_ONES * (uint8_t) value;
+    while (true) {
+        uint32_t word = loadWord(data);
+        if (SWAR_HAS_ZERO(word) || SWAR_HAS_BYTE(word, pattern)) {
+            for (uint8_t i = 0; i < SWAR_WORD_SIZE; i++) {
+                if (data[i] == value) return &data[i];
+                if (data[i] == '\0') return NULL;
+            }
+        }
+        data += SWAR_WORD_SIZE;
+    }
+}
+
+const char *findMarkerSWAR(const char *data, const char *marker) {
+    uint32_t markerLength = strlen(marker);
+    if (markerLength == 0) return data;
+
+    const char *candidate = findByteSWAR(data, marker[0]);
+    while (candidate != NULL) {
+        if (strncmp(candidate, marker, markerLength) == 0) return candidate;
+        candidate = findByteSWAR(candidate + 1, marker[0]);
+    }
+    return NULL;
+}
+
+ResponseStatusFlag classifyResponseLine(const char *line, uint32_t length) {
+    if (length > 0 && line[length - 1] == '\r') length--;
+    switch (length) {
+        case 2:
+            return isLineEquals(line, length, "OK", 2) ? RESPONSE_STATUS_OK : RESPONSE_STATUS_NONE;
+        case 4:
+            return isLineEquals(line, length, "FAIL", 4) ? RESPONSE_STATUS_FAIL : RESPONSE_STATUS_NONE;
+        case 5:
+            return isLineEquals(line, length, "ERROR", 5) ? RESPONSE_STATUS_ERROR : RESPONSE_STATUS_NONE;
+        case 7:
+            if (isLineEquals(line, length, "SEND OK", 7)) return RESPONSE_STATUS_SEND_OK;
+            break;
+        case 9:
+            if (isLineEquals(line, length, "SEND FAIL", 9)) return RESPONSE_STATUS_SEND_FAIL;
+            break;
+        default:
+            break;
+    }
+    return (length >= 6 && isLineEquals(&line[length - 6], 6, "CLOSED", 6)) ? RESPONSE_STATUS_CLOSED : RESPONSE_STATUS_NONE;   // "<id>,CLOSED"
+}
+
+static inline uint32_t loadWord(const char *data) {
+    uint32_t word;
+    memcpy(&word, data, SWAR_WORD_SIZE);    // aligned single load, never crosses into next word
+    return word;
+}
+
+static inline bool isLineEquals(const char *line, uint32_t length, const char *value, uint32_t valueLength) {
+    return length == valueLength && memcmp(line, value, valueLength) == 0;
+}
+
+void resetResponseMatcher(ResponseMatcher *matcher, const char *data) {
+    matcher->position = data;
+    matcher->lineStart = data;
+    matcher->status = RESPONSE_STATUS_NONE;
+}
+
+uint8_t feedResponseMatcher(ResponseMatcher *matcher, const char *dataEnd) {
+    const uint32_t newLinePattern = SWAR_ONES * '\n';
+    const char *position = matcher->position;
+    while (position < dataEnd) {
+        if (((uintptr_t) position & (SWAR_WORD_SIZE - 1)) == 0 &&
+            position + SWAR_WORD_SIZE <= dataEnd &&
+            position != matcher->lineStart &&
+            !SWAR_HAS_BYTE(loadWord(position), newLinePattern)) {
+            position += SWAR_WORD_SIZE;     // no line end in this word, prompt is expected only at line start
+            continue;
+        }
+
+        if (*position == '\n') {   // terminal line is complete, no need to wait for more data
+            matcher->status |= classifyResponseLine(matcher->lineStart, position - matcher->lineStart);
+            matcher->lineStart = position + 1;
+        } else if (*position == '>' && position == matcher->lineStart) {   // prompt is not followed by new line
+            matcher->status |= RESPONSE_STATUS_READY;
+        }
+        position++;
+    }
+    matcher->position = position;
+    return matcher->status;
+}
@@ -0,0 +1,105 @@
+#include "RequestBodyDecoder.h"
+
+#define CHUNK_SIZE_MAX_DIGITS 7    // far beyond any upload the module can buffer
+
+static int8_t hexDigitValue(char value);
+
+
+void initContentLengthDecoder(RequestBodyDecoder *decoder, uint32_t contentLength) {
+    decoder->state = (contentLength > 0) ? REQUEST_BODY_CONTENT : REQUEST_BODY_COMPLETE;
+    decoder->remainingLength = contentLength;
+    decoder->sizeDigitCount = 0;
+}
+
+void initChunkedDecoder(RequestBodyDecoder *decoder) {
+    decoder->state = REQUEST_BODY_CHUNK_SIZE;
+    decoder->remainingLength = 0;
+    decoder->sizeDigitCount = 0;
+}
+
+uint32_t decodeRequestBody(RequestBodyDecoder *decoder, const char *data, uint32_t length, const char **body, uint32_t *bodyLength) {
+    *body = NULL;
+    *bodyLength = 0;
+    uint32_t offset = 0;
+
+    while (offset < length && !isRequestBodyFinished(decoder)) {
+        char value = data[offset];
+
+        switch (decoder->state) {
+            case REQUEST_BODY_CONTENT:
+            case REQUEST_BODY_CHUNK_DATA: {
+                uint32_t spanLength = length - offset;
+                if (spanLength > decoder->remainingLength) {
+                    spanLength = decoder->remainingLength;
+                }
+                *body = &data[offset];
+                *bodyLength = spanLength;
+                decoder->remainingLength -= spanLength;
+                if (decoder->remainingLength == 0) {
+                    decoder->state = (decoder->state == REQUEST_BODY_CONTENT) ? REQUEST_BODY_COMPLETE : REQUEST_BODY_CHUNK_DATA_CR;
+                }
+                return offset + spanLength;
+            }
+
+            case REQUEST_BODY_CHUNK_SIZE: {
+                int8_t digit = hexDigitValue(value);
+                if (digit >= 0 && decoder->sizeDigitCount < CHUNK_SIZE_MAX_DIGITS) {
+                    decoder->remainingLength = (decoder->remainingLength << 4) | (uint8_t) digit;
+                    decoder->sizeDigitCount++;
+                } else if (decoder->sizeDigitCount > 0 && (value == ';' || value == ' ' || value == '\t')) {
+                    decoder->state = REQUEST_BODY_CHUNK_EXTENSION;
+                } else if (decoder->sizeDigitCount > 0 && value == '\r') {
+                    decoder->state = REQUEST_BODY_CHUNK_SIZE_END;
+                } else {
+                    decoder->state = REQUEST_BODY_INVALID;
+                }
+                break;
+            }
+
+            case REQUEST_BODY_CHUNK_EXTENSION:   // ignored
+                if (value == '\r') decoder->state = REQUEST_BODY_CHUNK_SIZE_END;
+                break;
+
+            case REQUEST_BODY_CHUNK_SIZE_END:
+                if (value != '\n') {
+                    decoder->state = REQUEST_BODY_INVALID;
+                } else {
+                    decoder->state = (decoder->remainingLength > 0) ? REQUEST_BODY_CHUNK_DATA : REQUEST_BODY_TRAILER_LINE_START;
+                    decoder->sizeDigitCount = 0;
+                }
+                break;
+
+            case REQUEST_BODY_CHUNK_DATA_CR:
+                decoder->state = (value == '\r') ? REQUEST_BODY_CHUNK_DATA_LF : REQUEST_BODY_INVALID;
+                break;
+
+            case REQUEST_BODY_CHUNK_DATA_LF:
+                decoder->state = (value == '\n') ? REQUEST_BODY_CHUNK_SIZE : REQUEST_BODY_INVALID;
+                break;
+
+            case REQUEST_BODY_TRAILER_LINE_START:    // empty line ends the body, trailer fields are skipped
+                decoder->state = (value == '\r') ? REQUEST_BODY_TRAILER_END : REQUEST_BODY_TRAILER_LINE;
+                break;
+
+            case REQUEST_BODY_TRAILER_LINE:
+                if (value == '\n') decoder->state = REQUEST_BODY_TRAILER_LINE_START;
+                break;
+
+            case REQUEST_BODY_TRAILER_END:
+                decoder->state = (value == '\n') ? REQUEST_BODY_COMPLETE : REQUEST_BODY_INVALID;
+                break;
+
+            default:
+                break;
+        }
+        offset++;
+    }
+    return offset;
+}
+
+static int8_t hexDigitValue(char value) {
+    if (value >= '0' && value <= '9') return (int8_t) (value - '0');
+    if (value >= 'a' && value <= 'f') return (int8_t) (value - 'a' + 10);
+    if (value >= 'A' && value <= 'F') return (int8_t) (value - 'A' + 10);
+    return -1;
+}
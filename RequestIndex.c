@@ -0,0 +1,173 @@
+#include "RequestIndex.h"
+
+#define REQUEST_MAX_INDEXED_LENGTH UINT16_MAX
+
+static inline char toLowerCase(char value);
+static inline int8_t hexDigitValue(char value);
+static bool isSpanEqualsIgnoreCase(const char *span, uint16_t length, const char *value);
+static uint32_t copySpan(const char *span, uint16_t length, char *valueBuffer, uint32_t bufferSize, bool isPercentDecoded);
+
+
+bool indexHttpRequest(RequestIndex *index, const char *request) {
+    memset(index, 0, sizeof(struct RequestIndex));
+    index->request = request;
+
+    uint32_t position = 0;
+    uint32_t tokenStart = 0;
+    uint8_t requestLineToken = 0;   // 0 - method, 1 - path, 2 - version
+
+    while (request[position] != '\r' && request[position] != '\n') {   // request line: METHOD SP path[?query] SP version CRLF
+        char value = request[position];
+        if (value == '\0' || position >= REQUEST_MAX_INDEXED_LENGTH) return false;
+
+        if (value == ' ') {
+            if (requestLineToken == 0) {
+                index->method = (RequestSpan) {tokenStart, position - tokenStart};
+            } else if (requestLineToken == 1) {
+                if (index->query.offset != 0) {
+                    index->query.length = position - index->query.offset;
+                } else {
+                    index->path = (RequestSpan) {tokenStart, position - tokenStart};
+                }
+            } else {
+                return false;
+            }
+            requestLineToken++;
+            tokenStart = position + 1;
+        } else if (value == '?' && requestLineToken == 1 && index->query.offset == 0) {
+            index->path = (RequestSpan) {tokenStart, position - tokenStart};
+            index->query.offset = position + 1;
+        }
+        position++;
+    }
+    if (requestLineToken != 2 || index->method.length == 0 || index->path.length == 0) return false;
+    index->version = (RequestSpan) {tokenStart, position - tokenStart};
+
+    while (true) {  // header block, each line "name: value" until empty line
+        if (request[position] == '\r') position++;
+        if (request[position] != '\n') return false;
+        position++;
+
+        if (request[position] == '\r' || request[position] == '\n') {  // empty line, end of headers
+            if (request[position] == '\r') position++;
+            if (request[position] != '\n') return false;
+            index->headerBlockLength = position + 1;
+            index->isValid = true;
+            return true;
+        }
+
+        uint32_t nameStart = position;
+        uint32_t nameEnd = 0;
+        uint32_t valueStart = 0;
+        uint32_t valueEnd = 0;
+        while (request[position] != '\r' && request[position] != '\n') {
+            char value = request[position];
+            if (value == '\0' || position >= REQUEST_MAX_INDEXED_LENGTH) return false;
+
+            if (value == ':' && nameEnd == 0) {
+                nameEnd = position;
+            } else if (nameEnd != 0 && valueStart == 0 && value != ' ' && value != '\t') {
+                valueStart = position;
+            }
+            if (valueStart != 0 && value != ' ' && value != '\t') {
+                valueEnd = position + 1;    // trim trailing whitespace
+            }
+            position++;
+        }
+        if (nameEnd == 0) return false;
+        if (valueStart == 0) valueStart = valueEnd = position;
+
+        if (index->headerCount < REQUEST_INDEX_MAX_HEADERS) {   // extra headers are skipped but still validated
+            RequestHeaderSpan *header = &index->headers[index->headerCount++];
+            header->name = (RequestSpan) {nameStart, nameEnd - nameStart};
+            header->value = (RequestSpan) {valueStart, valueEnd - valueStart};
+        }
+    }
+}
+
+const char *requestIndexFindHeader(const RequestIndex *index, const char *name, uint16_t *length) {
+    if (index == NULL || !index->isValid || name == NULL) return NULL;
+    for (uint8_t i = 0; i < index->headerCount; i++) {
+        const RequestHeaderSpan *header = &index->headers[i];
+        if (isSpanEqualsIgnoreCase(&index->request[header->name.offset], header->name.length, name)) {
+            *length = header->value.length;
+            return &index->request[header->value.offset];
+        }
+    }
+    return NULL;
+}
+
+bool requestIndexIsHeaderEquals(const RequestIndex *index, const char *name, const char *value) {
+    uint16_t length;
+    const char *headerValue = requestIndexFindHeader(index, name, &length);
+    return headerValue != NULL && value != NULL && isSpanEqualsIgnoreCase(headerValue, length, value);
+}
+
+bool requestIndexCopyHeader(const RequestIndex *index, const char *name, char *valueBuffer, uint32_t bufferSize) {
+    uint16_t length;
+    const char *value = requestIndexFindHeader(index, name, &length);
+    if (value == NULL || bufferSize == 0) return false;
+    return copySpan(value, length, valueBuffer, bufferSize, false) == length;
+}
+
+bool requestIndexCopyQueryParameter(const RequestIndex *index, const char *name, char *valueBuffer, uint32_t bufferSize) {
+    if (index == NULL || !index->isValid || name == NULL || bufferSize == 0) return false;
+    const char *query = &index->request[index->query.offset];
+    uint32_t nameLength = strlen(name);
+    uint32_t position = 0;
+
+    while (position < index->query.length) {    // "a=1&b=2", parameters are separated by '&'
+        uint32_t parameterEnd = position;
+        while (parameterEnd < index->query.length && query[parameterEnd] != '&') {
+            parameterEnd++;
+        }
+
+        if (parameterEnd - position >= nameLength &&
+            strncmp(&query[position], name, nameLength) == 0 &&
+            (position + nameLength == parameterEnd || query[position + nameLength] == '=')) {
+            uint32_t valueStart = position + nameLength + (position + nameLength < parameterEnd ? 1 : 0);
+            copySpan(&query[valueStart], parameterEnd - valueStart, valueBuffer, bufferSize, true);
+            return true;
+        }
+        position = parameterEnd + 1;
+    }
+    return false;
+}
+
+static inline char toLowerCase(char value) {
+    return (value >= 'A' && value <= 'Z') ? (char) (value + ('a' - 'A')) : value;
+}
+
+static inline int8_t hexDigitValue(char value) {
+    if (value >= '0' && value <= '9') return (int8_t) (value - '0');
+    if (value >= 'a' && value <= 'f') return (int8_t) (value - 'a' + 10);
+    if (value >= 'A' && value <= 'F') return (int8_t) (value - 'A' + 10);
+    return -1;
+}
+
+static bool isSpanEqualsIgnoreCase(const char *span, uint16_t length, const char *value) {
+    for (uint16_t i = 0; i < length; i++) {
+        if (value[i] == '\0' || toLowerCase(span[i]) != toLowerCase(value[i])) return false;
+    }
+    return value[length] == '\0';
+}
+
+static uint32_t copySpan(const char *span, uint16_t length, char *valueBuffer, uint32_t bufferSize, bool isPercentDecoded) {
+    uint32_t copied = 0;
+    for (uint16_t i = 0; i < length && copied < bufferSize - 1; i++) {
+        char value = span[i];
+        if (isPercentDecoded && value == '+') {
+            value = ' ';
+        } else if (isPercentDecoded && value == '%' && i + 2 < length) {
+            int8_t high = hexDigitValue(span[i + 1]);
+            int8_t low = hexDigitValue(span[i + 2]);
+            if (high >= 0 && low >= 0) {
+                value = (char) ((high << 4) | low);
+                i += 2;
+            }
+        }
+        valueBuffer[copied++] = value;
+    }
+    valueBuffer[copied] = '\0';
+    return copied;
+}
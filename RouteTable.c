@@ -0,0 +1,353 @@
+#include "RouteTable.h"
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+#define PATH_SEPARATOR '/'
+#define QUERY_SEPARATOR '?'
+#define VARIABLE_START '{'
+#define VARIABLE_END '}'
+#define VARIABLE_TYPE_SEPARATOR ':'
+
+struct ExactRoute {
+    uint32_t hash;
+    char *path;
+    RouteEntry route;
+    struct ExactRoute *next;
+};
+
+struct RouteNode {
+    char *segment;  // literal segment text or variable name
+    bool isVariable;
+    PathVariableType variableType;
+    RouteEntry *routes;
+    struct RouteNode *child;
+    struct RouteNode *sibling;
+};
+
+static inline bool isPathEnd(char value);
+static uint32_t getRoutePathLength(const char *path);
+static uint32_t hashPath(const char *path, uint32_t *length);
+static bool isPatternExact(const char *pathPattern);
+
+static RouteEntry *addExactRoute(RouteTable *table, const char *pathPattern, HTTPMethod method, RequestHandlerFunction handler);
+static RouteEntry *addTrieRoute(RouteTable *table, const char *pathPattern, HTTPMethod method, RequestHandlerFunction handler);
+static RouteNode *getOrCreateChildNode(RouteNode *parent, const char *segment, uint32_t length);
+static RouteNode *createRouteNode(const char *segment, uint32_t length, bool isVariable, PathVariableType variableType);
+static RouteEntry *addNodeRoute(RouteNode *node, HTTPMethod method, RequestHandlerFunction handler);
+
+static const RouteEntry *findNodeRoute(const RouteNode *node, HTTPMethod method);
+static const RouteEntry *matchRouteNode(const RouteNode *node, HTTPMethod method, const char *path, const char *pathEnd, RouteMatch *match);
+static bool parseIntSegment(const char *segment, uint32_t length, int32_t *value);
+static bool copyMatchedValues(RouteMatch *match);
+
+static void deleteRouteNode(RouteNode *node);
+static void deleteRouteEntries(RouteEntry *entry);
+
+
+RouteTable *getRouteTableInstance() {
+    RouteTable *instance = calloc(1, sizeof(struct RouteTable));
+    if (instance != NULL) {
+        instance->root = createRouteNode("", 0, false, PATH_VARIABLE_STRING);
+        if (instance->root == NULL) {
+            free(instance);
+            return NULL;
+        }
+    }
+    return instance;
+}
+
+RouteEntry *routeTableAdd(RouteTable *table, const char *pathPattern, HTTPMethod method, RequestHandlerFunction handler) {
+    if (table == NULL || pathPattern == NULL || pathPattern[0] != PATH_SEPARATOR || handler == NULL) return NULL;
+    if (isPatternExact(pathPattern)) {
+        return addExactRoute(table, pathPattern, method, handler);
+    }
+    return addTrieRoute(table, pathPattern, method, handler);
+}
+
+bool routeTableFind(RouteTable *table, HTTPMethod method, const char *path, RouteMatch *match) {
+    match->route = NULL;
+    match->variableCount = 0;
+    if (table == NULL || path == NULL) return false;
+
+    uint32_t pathLength;
+    uint32_t hash = hashPath(path, &pathLength);
+    ExactRoute *exactRoute = table->buckets[(hash ^ method) & (ROUTE_TABLE_BUCKET_COUNT - 1)];
+    while (exactRoute != NULL) {
+        if (exactRoute->hash == hash &&
+            exactRoute->route.method == method &&
+            strncmp(exactRoute->path, path, pathLength) == 0 &&
+            exactRoute->path[pathLength] == '\0') {
+            match->route = &exactRoute->route;
+            return true;
+        }
+        exactRoute = exactRoute->next;
+    }
+
+    match->route = matchRouteNode(table->root, method, path, path + pathLength, match);
+    return match->route != NULL && copyMatchedValues(match);
+}
+
+const PathVariable *routeMatchGetVariable(const RouteMatch *match, const char *name) {
+    if (match == NULL || name == NULL) return NULL;
+    for (uint8_t i = 0; i < match->variableCount; i++) {
+        if (strcmp(match->variables[i].name, name) == 0) {
+            return &match->variables[i];
+        }
+    }
+    return NULL;
+}
+
+void routeTableDelete(RouteTable *table) {
+    if (table != NULL) {
+        for (uint32_t i = 0; i < ROUTE_TABLE_BUCKET_COUNT; i++) {
+            ExactRoute *exactRoute = table->buckets[i];
+            while (exactRoute != NULL) {
+                ExactRoute *next = exactRoute->next;
+                free(exactRoute->path);
+                free(exactRoute);
+                exactRoute = next;
+            }
+        }
+        deleteRouteNode(table->root);
+        free(table);
+    }
+}
+
+static inline bool isPathEnd(char value) {   // space ends path inside raw request line
+    return value == '\0' || value == QUERY_SEPARATOR || value == ' ';
+}
+
+static uint32_t getRoutePathLength(const char *path) {  // stops at query string, single trailing slash is not part of the path
+    uint32_t length = 0;
+    while (!isPathEnd(path[length])) {
+        length++;
+    }
+    if (length > 1 && path[length - 1] == PATH_SEPARATOR) {
+        length--;
+    }
+    return length;
+}
+
+static uint32_t hashPath(const char *path, uint32_t *length) {  // FNV-1a over normalized path
+    uint32_t hash = FNV_OFFSET_BASIS;
+    *length = getRoutePathLength(path);
+    for (uint32_t index = 0; index < *length; index++) {
+        hash ^= (uint8_t) path[index];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static bool isPatternExact(const char *pathPattern) {
+    return strchr(pathPattern, VARIABLE_START) == NULL;
+}
+
+static RouteEntry *addExactRoute(RouteTable *table, const char *pathPattern, HTTPMethod method, RequestHandlerFunction handler) {
+    uint32_t pathLength;
+    uint32_t hash = hashPath(pathPattern, &pathLength);
+    uint32_t bucketIndex = (hash ^ method) & (ROUTE_TABLE_BUCKET_COUNT - 1);
+
+    ExactRoute *exactRoute = malloc(sizeof(struct ExactRoute));
+    if (exactRoute == NULL) return NULL;
+    exactRoute->path = malloc(pathLength + 1);
+    if (exactRoute->path == NULL) {
+        free(exactRoute);
+        return NULL;
+    }
+    memcpy(exactRoute->path, pathPattern, pathLength);
+    exactRoute->path[pathLength] = '\0';
+    exactRoute->hash = hash;
+    exactRoute->route.method = method;
+    exactRoute->route.handler = handler;
+    exactRoute->route.priority = ROUTE_PRIORITY_NORMAL;
+    exactRoute->route.attachment = NULL;
+    exactRoute->route.next = NULL;
+    exactRoute->next = table->buckets[bucketIndex];
+    table->buckets[bucketIndex] = exactRoute;
+    return &exactRoute->route;
+}
+
+static RouteEntry *addTrieRoute(RouteTable *table, const char *pathPattern, HTTPMethod method, RequestHandlerFunction handler) {
+    RouteNode *node = table->root;
+    const char *segment = pathPattern;
+    uint8_t variableCount = 0;
+
+    while (!isPathEnd(*segment) && !(segment[0] == PATH_SEPARATOR && isPathEnd(segment[1]))) {
+        segment++;  // skip separator
+        uint32_t length = 0;
+        while (!isPathEnd(segment[length]) && segment[length] != PATH_SEPARATOR) {
+            length++;
+        }
+
+        if (segment[0] == VARIABLE_START && ++variableCount > ROUTE_MAX_PATH_VARIABLES) return NULL;
+        node = getOrCreateChildNode(node, segment, length);
+        if (node == NULL) return NULL;
+        segment += length;
+    }
+    return addNodeRoute(node, method, handler);
+}
+
+static RouteNode *getOrCreateChildNode(RouteNode *parent, const char *segment, uint32_t length) {
+    bool isVariable = false;
+    PathVariableType variableType = PATH_VARIABLE_STRING;
+
+    if (length > 0 && segment[0] == VARIABLE_START) {   // "{name}", "{name:str}" or "{name:int}"
+        if (length < 3 || segment[length - 1] != VARIABLE_END) return NULL;
+        const char *typeSeparator = memchr(segment, VARIABLE_TYPE_SEPARATOR, length);
+        uint32_t nameLength = (typeSeparator != NULL ? (uint32_t) (typeSeparator - segment) : length - 1) - 1;
+        if (typeSeparator != NULL) {
+            uint32_t typeLength = length - (typeSeparator - segment) - 2;
+            if (typeLength == 3 && strncmp(typeSeparator + 1, "int", 3) == 0) {
+                variableType = PATH_VARIABLE_INT;
+            } else if (!(typeLength == 3 && strncmp(typeSeparator + 1, "str", 3) == 0)) {
+                return NULL;    // unknown variable type
+            }
+        }
+        if (nameLength == 0) return NULL;
+        isVariable = true;
+        segment++;
+        length = nameLength;
+    }
+
+    RouteNode *child = parent->child;
+    while (child != NULL) {
+        if (child->isVariable == isVariable &&
+            child->variableType == variableType &&
+            strncmp(child->segment, segment, length) == 0 &&
+            child->segment[length] == '\0') {
+            return child;
+        }
+        child = child->sibling;
+    }
+
+    child = createRouteNode(segment, length, isVariable, variableType);
+    if (child != NULL) {
+        child->sibling = parent->child;
+        parent->child = child;
+    }
+    return child;
+}
+
+static RouteNode *createRouteNode(const char *segment, uint32_t length, bool isVariable, PathVariableType variableType) {
+    RouteNode *node = calloc(1, sizeof(struct RouteNode));
+    if (node == NULL) return NULL;
+    node->segment = malloc(length + 1);
+    if (node->segment == NULL) {
+        free(node);
+        return NULL;
+    }
+    memcpy(node->segment, segment, length);
+    node->segment[length] = '\0';
+    node->isVariable = isVariable;
+    node->variableType = variableType;
+    return node;
+}
+
+static RouteEntry *addNodeRoute(RouteNode *node, HTTPMethod method, RequestHandlerFunction handler) {
+    RouteEntry *entry = malloc(sizeof(struct RouteEntry));
+    if (entry == NULL) return NULL;
+    entry->method = method;
+    entry->handler = handler;
+    entry->priority = ROUTE_PRIORITY_NORMAL;
+    entry->attachment = NULL;
+    entry->next = node->routes;
+    node->routes = entry;
+    return entry;
+}
+
+static const RouteEntry *findNodeRoute(const RouteNode *node, HTTPMethod method) {
+    const RouteEntry *entry = node->routes;
+    while (entry != NULL && entry->method != method) {
+        entry = entry->next;
+    }
+    return entry;
+}
+
+static const RouteEntry *matchRouteNode(const RouteNode *node, HTTPMethod method, const char *path, const char *pathEnd, RouteMatch *match) {
+    if (path >= pathEnd || (path[0] == PATH_SEPARATOR && path + 1 == pathEnd)) {    // end of path or root "/"
+        return findNodeRoute(node, method);
+    }
+
+    const char *segment = path + 1;
+    uint32_t length = 0;
+    while (segment + length < pathEnd && segment[length] != PATH_SEPARATOR) {
+        length++;
+    }
+
+    for (const RouteNode *child = node->child; child != NULL; child = child->sibling) {   // literal segments take precedence
+        if (!child->isVariable && strncmp(child->segment, segment, length) == 0 && child->segment[length] == '\0') {
+            const RouteEntry *entry = matchRouteNode(child, method, segment + length, pathEnd, match);
+            if (entry != NULL) return entry;
+        }
+    }
+
+    if (length == 0 || match->variableCount >= ROUTE_MAX_PATH_VARIABLES) return NULL;
+    for (const RouteNode *child = node->child; child != NULL; child = child->sibling) {
+        if (!child->isVariable) continue;
+
+        PathVariable *variable = &match->variables[match->variableCount];
+        if (child->variableType == PATH_VARIABLE_INT && !parseIntSegment(segment, length, &variable->intValue)) continue;
+        variable->name = child->segment;
+        variable->value = segment; // raw pointer into path, copied after full match
+        variable->length = length;
+        variable->type = child->variableType;
+        match->variableCount++;
+
+        const RouteEntry *entry = matchRouteNode(child, method, segment + length, pathEnd, match);
+        if (entry != NULL) return entry;
+        match->variableCount--;
+    }
+    return NULL;
+}
+
+static bool parseIntSegment(const char *segment, uint32_t length, int32_t *value) {
+    bool isNegative = segment[0] == '-';
+    uint32_t index = isNegative ? 1 : 0;
+    if (index == length) return false;
+
+    int64_t result = 0;
+    for (; index < length; index++) {
+        if (segment[index] < '0' || segment[index] > '9') return false;
+        result = result * 10 + (segment[index] - '0');
+        if (result > (int64_t) INT32_MAX + 1) return false;
+    }
+    if (!isNegative && result > INT32_MAX) return false;
+    *value = (int32_t) (isNegative ? -result : result);
+    return true;
+}
+
+static bool copyMatchedValues(RouteMatch *match) {
+    uint32_t offset = 0;
+    for (uint8_t i = 0; i < match->variableCount; i++) {
+        PathVariable *variable = &match->variables[i];
+        if (offset + variable->length + 1 > ROUTE_PATH_VALUES_BUFFER_SIZE) {
+            match->route = NULL;
+            return false;
+        }
+        memcpy(&match->valuesBuffer[offset], variable->value, variable->length);
+        match->valuesBuffer[offset + variable->length] = '\0';
+        variable->value = &match->valuesBuffer[offset];
+        offset += variable->length + 1;
+    }
+    return true;
+}
+
+static void deleteRouteNode(RouteNode *node) {
+    while (node != NULL) {
+        RouteNode *sibling = node->sibling;
+        deleteRouteNode(node->child);
+        deleteRouteEntries(node->routes);
+        free(node->segment);
+        free(node);
+        node = sibling;
+    }
+}
+
+static void deleteRouteEntries(RouteEntry *entry) {
+    while (entry != NULL) {
+        RouteEntry *next = entry->next;
+        free(entry);
+        entry = next;
+    }
+}
@@ -1,4 +1,5 @@
 #include "USART_Buffered.h"
+#include "ESP8266Trace.h"
 
 #define NUMBER_OF_USART_INSTANCES 3
 
@@ -64,6 +65,17 @@ void sendStringUSART(USART *USARTPointer, const char *string) {
     LL_USART_EnableIT_TXE(USARTPointer->USARTx);
 }
 
+void sendDataUSART(USART *USARTPointer, const char *data, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        if (isStringRingBufferFull(USARTPointer->TxBuffer)) {
+            LL_USART_EnableIT_TXE(USARTPointer->USARTx);  // if data is bigger than buffer size enable Tx interrupt and wait until data is send
+            while (isStringRingBufferFull(USARTPointer->TxBuffer));
+        }
+        stringRingBufferAdd(USARTPointer->TxBuffer, data[i]);
+    }
+    LL_USART_EnableIT_TXE(USARTPointer->USARTx);
+}
+
 void sendFormattedStringUSART(USART *USARTPointer, uint16_t bufferLength, char *format, ...) {
     char formatBuffer[bufferLength];
     va_list args;
@@ -150,11 +162,15 @@ static void txInterruptCallbackUSART(USART *USARTPointer) {
 static void clearInterruptFlag(USART *USARTPointer) {
     if (LL_USART_IsActiveFlag_ORE(USARTPointer->USARTx)) {
         LL_USART_ClearFlag_ORE(USARTPointer->USARTx);
+        TRACE_EVENT(TRACE_USART_ERROR, ESP8266_TRACE_NO_LINK, TRACE_USART_OVERRUN);
     } else if (LL_USART_IsActiveFlag_FE(USARTPointer->USARTx)) {
         LL_USART_ClearFlag_FE(USARTPointer->USARTx);
+        TRACE_EVENT(TRACE_USART_ERROR, ESP8266_TRACE_NO_LINK, TRACE_USART_FRAMING);
     } else if (LL_USART_IsActiveFlag_NE(USARTPointer->USARTx)) {
         LL_USART_ClearFlag_NE(USARTPointer->USARTx);
+        TRACE_EVENT(TRACE_USART_ERROR, ESP8266_TRACE_NO_LINK, TRACE_USART_NOISE);
     } else if (LL_USART_IsActiveFlag_PE(USARTPointer->USARTx)) {
         LL_USART_ClearFlag_PE(USARTPointer->USARTx);
+        TRACE_EVENT(TRACE_USART_ERROR, ESP8266_TRACE_NO_LINK, TRACE_USART_PARITY);
     }
 }
\ No newline at end of file
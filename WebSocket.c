@@ -0,0 +1,198 @@
+#include "WebSocket.h"
+
+#define SHA1_DIGEST_LENGTH 20
+#define SHA1_BLOCK_LENGTH 64
+
+#define WEBSOCKET_FIN_BIT 0x80
+#define WEBSOCKET_RESERVED_BITS 0x70
+#define WEBSOCKET_OPCODE_MASK 0x0F
+#define WEBSOCKET_MASK_BIT 0x80
+#define WEBSOCKET_PAYLOAD_LENGTH_MASK 0x7F
+#define WEBSOCKET_PAYLOAD_LENGTH_16 126
+#define WEBSOCKET_PAYLOAD_LENGTH_64 127
+#define WEBSOCKET_MASKING_KEY_LENGTH 4
+
+typedef struct Sha1Context {
+    uint32_t state[5];
+    uint8_t block[SHA1_BLOCK_LENGTH];
+    uint32_t blockLength;
+    uint64_t totalLength;
+} Sha1Context;
+
+static const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void sha1Init(Sha1Context *sha1);
+static void sha1Update(Sha1Context *sha1, const uint8_t *data, uint32_t length);
+static void sha1Final(Sha1Context *sha1, uint8_t *digest);
+static void sha1Transform(uint32_t *state, const uint8_t *block);
+static inline uint32_t rotateLeft(uint32_t value, uint8_t bits);
+static void encodeBase64(const uint8_t *data, uint32_t length, char *encoded);
+
+
+bool createWebSocketAcceptKey(const char *clientKey, uint16_t keyLength, char *acceptKey) {
+    if (clientKey == NULL || keyLength == 0 || keyLength > WEBSOCKET_MAX_CLIENT_KEY_LENGTH) return false;
+    uint8_t digest[SHA1_DIGEST_LENGTH];
+    Sha1Context sha1;
+    sha1Init(&sha1);
+    sha1Update(&sha1, (const uint8_t *) clientKey, keyLength);
+    sha1Update(&sha1, (const uint8_t *) WEBSOCKET_GUID, strlen(WEBSOCKET_GUID));
+    sha1Final(&sha1, digest);
+    encodeBase64(digest, SHA1_DIGEST_LENGTH, acceptKey);
+    return true;
+}
+
+WebSocketFrameStatus parseWebSocketFrame(char *data, uint32_t length, WebSocketFrame *frame) {
+    uint8_t *bytes = (uint8_t *) data;
+    if (length < 2) return WEBSOCKET_FRAME_INCOMPLETE;
+    if ((bytes[0] & WEBSOCKET_RESERVED_BITS) != 0 || (bytes[1] & WEBSOCKET_MASK_BIT) == 0) {
+        return WEBSOCKET_FRAME_INVALID;    // no extensions negotiated, client frames must be masked
+    }
+
+    frame->isFinal = (bytes[0] & WEBSOCKET_FIN_BIT) != 0;
+    frame->opcode = (WebSocketOpcode) (bytes[0] & WEBSOCKET_OPCODE_MASK);
+    uint32_t headerLength = 2;
+    uint64_t payloadLength = bytes[1] & WEBSOCKET_PAYLOAD_LENGTH_MASK;
+
+    if (payloadLength == WEBSOCKET_PAYLOAD_LENGTH_16) {
+        if (length < 4) return WEBSOCKET_FRAME_INCOMPLETE;
+        payloadLength = ((uint32_t) bytes[2] << 8) | bytes[3];
+        headerLength = 4;
+    } else if (payloadLength == WEBSOCKET_PAYLOAD_LENGTH_64) {
+        if (length < 10) return WEBSOCKET_FRAME_INCOMPLETE;
+        payloadLength = 0;
+        for (uint8_t i = 0; i < 8; i++) {
+            payloadLength = (payloadLength << 8) | bytes[2 + i];
+        }
+        if (payloadLength > UINT32_MAX - 14) return WEBSOCKET_FRAME_INVALID;
+        headerLength = 10;
+    }
+
+    if (length < headerLength + WEBSOCKET_MASKING_KEY_LENGTH + payloadLength) return WEBSOCKET_FRAME_INCOMPLETE;
+    const uint8_t *maskingKey = &bytes[headerLength];
+    uint8_t *payload = &bytes[headerLength + WEBSOCKET_MASKING_KEY_LENGTH];
+    for (uint32_t i = 0; i < payloadLength; i++) {
+        payload[i] ^= maskingKey[i & (WEBSOCKET_MASKING_KEY_LENGTH - 1)];
+    }
+
+    frame->payload = (char *) payload;
+    frame->payloadLength = (uint32_t) payloadLength;
+    frame->frameLength = headerLength + WEBSOCKET_MASKING_KEY_LENGTH + (uint32_t) payloadLength;
+    return WEBSOCKET_FRAME_OK;
+}
+
+uint8_t formatWebSocketFrameHeader(char *buffer, WebSocketOpcode opcode, uint32_t payloadLength) {
+    uint8_t *bytes = (uint8_t *) buffer;
+    bytes[0] = WEBSOCKET_FIN_BIT | (opcode & WEBSOCKET_OPCODE_MASK);
+    if (payloadLength < WEBSOCKET_PAYLOAD_LENGTH_16) {
+        bytes[1] = (uint8_t) payloadLength;
+        return 2;
+    }
+    bytes[1] = WEBSOCKET_PAYLOAD_LENGTH_16;
+    bytes[2] = (uint8_t) (payloadLength >> 8);
+    bytes[3] = (uint8_t) payloadLength;
+    return WEBSOCKET_MAX_SERVER_HEADER_LENGTH;
+}
+
+static void sha1Init(Sha1Context *sha1) {
+    sha1->state[0] = 0x67452301;
+    sha1->state[1] = 0xEFCDAB89;
+    sha1->state[2] = 0x98BADCFE;
+    sha1->state[3] = 0x10325476;
+    sha1->state[4] = 0xC3D2E1F0;
+    sha1->blockLength = 0;
+    sha1->totalLength = 0;
+}
+
+static void sha1Update(Sha1Context *sha1, const uint8_t *data, uint32_t length) {
+    sha1->totalLength += length;
+    for (uint32_t i = 0; i < length; i++) {
+        sha1->block[sha1->blockLength++] = data[i];
+        if (sha1->blockLength == SHA1_BLOCK_LENGTH) {
+            sha1Transform(sha1->state, sha1->block);
+            sha1->blockLength = 0;
+        }
+    }
+}
+
+static void sha1Final(Sha1Context *sha1, uint8_t *digest) {
+    uint64_t totalBits = sha1->totalLength * 8;
+    uint8_t padding = 0x80;
+    sha1Update(sha1, &padding, 1);
+    padding = 0;
+    while (sha1->blockLength != SHA1_BLOCK_LENGTH - 8) {
+        sha1Update(sha1, &padding, 1);
+    }
+
+    uint8_t lengthBytes[8];
+    for (uint8_t i = 0; i < 8; i++) {
+        lengthBytes[i] = (uint8_t) (totalBits >> (56 - i * 8));
+    }
+    sha1Update(sha1, lengthBytes, 8);
+
+    for (uint8_t i = 0; i < SHA1_DIGEST_LENGTH; i++) {
+        digest[i] = (uint8_t) (sha1->state[i / 4] >> (24 - (i % 4) * 8));
+    }
+}
+
+static void sha1Transform(uint32_t *state, const uint8_t *block) {
+    uint32_t words[16];
+    for (uint8_t i = 0; i < 16; i++) {
+        words[i] = ((uint32_t) block[i * 4] << 24) | ((uint32_t) block[i * 4 + 1] << 16) |
+                   ((uint32_t) block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (uint8_t i = 0; i < 80; i++) {
+        if (i >= 16) {  // message schedule kept in 16 word circular buffer
+            words[i & 15] = rotateLeft(words[(i + 13) & 15] ^ words[(i + 8) & 15] ^ words[(i + 2) & 15] ^ words[i & 15], 1);
+        }
+
+        uint32_t function;
+        uint32_t constant;
+        if (i < 20) {
+            function = (b & c) | (~b & d);
+            constant = 0x5A827999;
+        } else if (i < 40) {
+            function = b ^ c ^ d;
+            constant = 0x6ED9EBA1;
+        } else if (i < 60) {
+            function = (b & c) | (b & d) | (c & d);
+            constant = 0x8F1BBCDC;
+        } else {
+            function = b ^ c ^ d;
+            constant = 0xCA62C1D6;
+        }
+
+        uint32_t temp = rotateLeft(a, 5) + function + e + constant + words[i & 15];
+        e = d;
+        d = c;
+        c = rotateLeft(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+static inline uint32_t rotateLeft(uint32_t value, uint8_t bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static void encodeBase64(const uint8_t *data, uint32_t length, char *encoded) {
+    uint32_t outputIndex = 0;
+    for (uint32_t i = 0; i < length; i += 3) {
+        uint32_t triple = (uint32_t) data[i] << 16;
+        if (i + 1 < length) triple |= (uint32_t) data[i + 1] << 8;
+        if (i + 2 < length) triple |= data[i + 2];
+
+        encoded[outputIndex++] = BASE64_ALPHABET[(triple >> 18) & 0x3F];
+        encoded[outputIndex++] = BASE64_ALPHABET[(triple >> 12) & 0x3F];
+        encoded[outputIndex++] = (i + 1 < length) ? BASE64_ALPHABET[(triple >> 6) & 0x3F] : '=';
+        encoded[outputIndex++] = (i + 2 < length) ? BASE64_ALPHABET[triple & 0x3F] : '=';
+    }
+    encoded[outputIndex] = '\0';
+}
@@ -0,0 +1,135 @@
+# Compiles HTML templates into headers with segment table of static slices and value slots.
+#
+# Usage in project CMakeLists.txt:
+#   add_html_templates(TEMPLATE_HEADERS ${CMAKE_BINARY_DIR}/templates ${CMAKE_SOURCE_DIR}/web/status.html)
+#   include_directories(${CMAKE_BINARY_DIR}/templates)
+#   add_executable(${PROJECT_NAME}.elf ${SOURCES} ${TEMPLATE_HEADERS})
+#
+# status.html generates status_template.h with STATUS_TEMPLATE and STATUS_SLOT_<NAME> indexes.
+# Placeholders: "{{name}}" variable width value, "{{name:8}}" value padded or cut to 8 characters.
+
+if (CMAKE_SCRIPT_MODE_FILE AND NOT DEFINED HTML_TEMPLATE_COMPILER_LOADED)   # cmake -DTEMPLATE_FILE=... -DOUTPUT_FILE=... -P HTMLTemplate.cmake
+    cmake_minimum_required(VERSION 3.20)
+    get_filename_component(TEMPLATE_NAME ${TEMPLATE_FILE} NAME_WE)
+    string(TOUPPER ${TEMPLATE_NAME} TEMPLATE_PREFIX)
+    string(MAKE_C_IDENTIFIER ${TEMPLATE_PREFIX} TEMPLATE_PREFIX)
+    file(READ ${TEMPLATE_FILE} TEMPLATE_CONTENT)
+
+    set(SEGMENTS "")
+    set(SLOT_NAMES "")
+    set(SEGMENT_COUNT 0)
+    set(FIXED_LENGTH 0)
+    set(IS_FIXED_LENGTH true)
+
+    macro(append_static_segment TEXT_VARIABLE)    # content is passed by variable name, macro arguments are parsed again
+        string(LENGTH "${${TEXT_VARIABLE}}" TEXT_LENGTH)
+        if (TEXT_LENGTH GREATER 65535)
+            message(FATAL_ERROR "${TEMPLATE_FILE}: static slice is longer than 65535 bytes")
+        endif ()
+        if (TEXT_LENGTH GREATER 0)
+            set(LITERAL "${${TEXT_VARIABLE}}")
+            string(REPLACE "\\" "\\\\" LITERAL "${LITERAL}")
+            string(REPLACE "\"" "\\\"" LITERAL "${LITERAL}")
+            string(REPLACE "\t" "\\t" LITERAL "${LITERAL}")
+            string(REPLACE "\r" "\\r" LITERAL "${LITERAL}")
+            string(REPLACE "\n" "\\n\"\n         \"" LITERAL "${LITERAL}")
+            string(APPEND SEGMENTS "        {\"${LITERAL}\", ${TEXT_LENGTH}, 0},\n")
+            math(EXPR SEGMENT_COUNT "${SEGMENT_COUNT} + 1")
+            math(EXPR FIXED_LENGTH "${FIXED_LENGTH} + ${TEXT_LENGTH}")
+        endif ()
+    endmacro()
+
+    while (TRUE)
+        string(FIND "${TEMPLATE_CONTENT}" "{{" PLACEHOLDER_START)
+        if (PLACEHOLDER_START EQUAL -1)
+            append_static_segment(TEMPLATE_CONTENT)
+            break()
+        endif ()
+        string(SUBSTRING "${TEMPLATE_CONTENT}" 0 ${PLACEHOLDER_START} STATIC_TEXT)
+        append_static_segment(STATIC_TEXT)
+
+        math(EXPR PLACEHOLDER_START "${PLACEHOLDER_START} + 2")
+        string(SUBSTRING "${TEMPLATE_CONTENT}" ${PLACEHOLDER_START} -1 TEMPLATE_CONTENT)
+        string(FIND "${TEMPLATE_CONTENT}" "}}" PLACEHOLDER_END)
+        if (PLACEHOLDER_END EQUAL -1)
+            message(FATAL_ERROR "${TEMPLATE_FILE}: unclosed placeholder")
+        endif ()
+        string(SUBSTRING "${TEMPLATE_CONTENT}" 0 ${PLACEHOLDER_END} PLACEHOLDER)
+        string(STRIP "${PLACEHOLDER}" PLACEHOLDER)
+        math(EXPR PLACEHOLDER_END "${PLACEHOLDER_END} + 2")
+        string(SUBSTRING "${TEMPLATE_CONTENT}" ${PLACEHOLDER_END} -1 TEMPLATE_CONTENT)
+
+        if (NOT PLACEHOLDER MATCHES "^([A-Za-z_][A-Za-z0-9_]*)(:([0-9]+))?$")
+            message(FATAL_ERROR "${TEMPLATE_FILE}: invalid placeholder \"{{${PLACEHOLDER}}}\"")
+        endif ()
+        string(TOUPPER ${CMAKE_MATCH_1} SLOT_NAME)
+        set(SLOT_WIDTH 0)
+        if (CMAKE_MATCH_3)
+            set(SLOT_WIDTH ${CMAKE_MATCH_3})
+            if (SLOT_WIDTH GREATER 65535)
+                message(FATAL_ERROR "${TEMPLATE_FILE}: slot width of \"{{${PLACEHOLDER}}}\" is over 65535")
+            endif ()
+            math(EXPR FIXED_LENGTH "${FIXED_LENGTH} + ${SLOT_WIDTH}")
+        else ()
+            set(IS_FIXED_LENGTH false)
+        endif ()
+
+        list(FIND SLOT_NAMES ${SLOT_NAME} SLOT_INDEX)
+        if (SLOT_INDEX EQUAL -1)    # same name reuses value slot
+            list(LENGTH SLOT_NAMES SLOT_INDEX)
+            list(APPEND SLOT_NAMES ${SLOT_NAME})
+        endif ()
+        string(APPEND SEGMENTS "        {NULL, ${SLOT_WIDTH}, ${TEMPLATE_PREFIX}_SLOT_${SLOT_NAME}},\n")
+        math(EXPR SEGMENT_COUNT "${SEGMENT_COUNT} + 1")
+    endwhile ()
+
+    list(LENGTH SLOT_NAMES SLOT_COUNT)
+    if (SLOT_COUNT GREATER 255)     # limits of TemplateSegment and HTMLTemplate fields
+        message(FATAL_ERROR "${TEMPLATE_FILE}: more than 255 slots")
+    endif ()
+    if (SEGMENT_COUNT GREATER 65535)
+        message(FATAL_ERROR "${TEMPLATE_FILE}: more than 65535 segments")
+    endif ()
+
+    set(SLOT_ENUM "")
+    foreach (SLOT_NAME ${SLOT_NAMES})
+        string(APPEND SLOT_ENUM "    ${TEMPLATE_PREFIX}_SLOT_${SLOT_NAME},\n")
+    endforeach ()
+    if (NOT IS_FIXED_LENGTH)
+        set(FIXED_LENGTH 0)
+    endif ()
+
+    file(WRITE ${OUTPUT_FILE}.tmp
+            "// Generated from ${TEMPLATE_NAME}.html, do not edit\n"
+            "#pragma once\n\n"
+            "#include \"HTMLTemplate.h\"\n\n"
+            "enum {\n${SLOT_ENUM}    ${TEMPLATE_PREFIX}_SLOT_COUNT\n};\n\n"
+            "static const TemplateSegment ${TEMPLATE_PREFIX}_SEGMENTS[] = {\n${SEGMENTS}};\n\n"
+            "static const HTMLTemplate ${TEMPLATE_PREFIX}_TEMPLATE = {\n"
+            "        ${TEMPLATE_PREFIX}_SEGMENTS, ${SEGMENT_COUNT}, ${TEMPLATE_PREFIX}_SLOT_COUNT, ${IS_FIXED_LENGTH}, ${FIXED_LENGTH}\n"
+            "};\n")
+    configure_file(${OUTPUT_FILE}.tmp ${OUTPUT_FILE} COPYONLY)    # timestamp changes only with content
+    file(REMOVE ${OUTPUT_FILE}.tmp)
+    return()
+endif ()
+
+set(HTML_TEMPLATE_COMPILER_LOADED TRUE)
+set(HTML_TEMPLATE_COMPILER ${CMAKE_CURRENT_LIST_FILE} CACHE INTERNAL "HTML template compiler script")
+
+function(add_html_templates OUTPUT_VARIABLE OUTPUT_DIRECTORY)
+    set(GENERATED_HEADERS "")
+    foreach (TEMPLATE_FILE ${ARGN})
+        get_filename_component(TEMPLATE_FILE ${TEMPLATE_FILE} ABSOLUTE)
+        get_filename_component(TEMPLATE_NAME ${TEMPLATE_FILE} NAME_WE)
+        set(OUTPUT_FILE ${OUTPUT_DIRECTORY}/${TEMPLATE_NAME}_template.h)
+        add_custom_command(
+                OUTPUT ${OUTPUT_FILE}
+                COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTPUT_DIRECTORY}
+                COMMAND ${CMAKE_COMMAND} -DTEMPLATE_FILE=${TEMPLATE_FILE} -DOUTPUT_FILE=${OUTPUT_FILE} -P ${HTML_TEMPLATE_COMPILER}
+                DEPENDS ${TEMPLATE_FILE} ${HTML_TEMPLATE_COMPILER}
+                COMMENT "Compiling HTML template ${TEMPLATE_NAME}"
+                VERBATIM)
+        list(APPEND GENERATED_HEADERS ${OUTPUT_FILE})
+    endforeach ()
+    set(${OUTPUT_VARIABLE} ${GENERATED_HEADERS} PARENT_SCOPE)
+endfunction()
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define AT_COMMAND_END "\r\n"   // ESP8266 expects <CR><LF> at the end of each command
+#define AT_COMMAND_END_LENGTH 2
+#define UNSIGNED_DECIMAL_MAX_LENGTH 10  // u32 max digit count
+
+typedef struct ATCommand {
+    char *buffer;
+    uint16_t length;
+    uint16_t capacity;
+    bool isOverflow;    // set when any append does not fit, command must not be sent
+} ATCommand;
+
+ATCommand createATCommand(char *buffer, uint16_t capacity, const char *command);
+
+void appendATLiteral(ATCommand *command, const char *literal);
+void appendATQuotedString(ATCommand *command, const char *value);   // "value" with '"', ',' and '\' escaped
+void appendATUnsigned(ATCommand *command, uint32_t value);
+bool finishATCommand(ATCommand *command);
+
+uint8_t formatUnsignedDecimal(char *buffer, uint32_t value);    // buffer at least UNSIGNED_DECIMAL_MAX_LENGTH + 1
@@ -1,13 +1,38 @@
 #pragma once
 
-#include <stdarg.h>
-
 #include "HTTPServer.h"
 #include "USART_Buffered.h"
 #include "DWT_Delay.h"
+#include "ATCommandBuilder.h"
+#include "MarkerScanner.h"
+#include "RouteTable.h"
+#include "RequestIndex.h"
+#include "WebSocket.h"
+#include "RequestBodyDecoder.h"
+#include "ESP8266Trace.h"
+#include "HTMLTemplate.h"
 
 #define ESP8266_KEEPALIVE_ATTEMPT_COUNT 3
 #define ESP8266_INNER_TX_BUFFER_SIZE 2048
+#define ESP8266_MAX_LINK_COUNT 5    // link ids 0-4
+
+#ifndef ESP8266_LINK_CHECK_PERIOD_MS
+#define ESP8266_LINK_CHECK_PERIOD_MS 10000  // AT+CIPSTATUS poll while connected
+#endif
+
+#ifndef ESP8266_RECONNECT_PERIOD_MS
+#define ESP8266_RECONNECT_PERIOD_MS 3000    // join attempt interval while disconnected, each attempt blocks up to serverTimeoutMs
+#endif
+
+#define ESP8266_BSSID_LENGTH 17     // "aa:bb:cc:dd:ee:ff"
+
+#ifndef ESP8266_RATE_LIMIT_CLIENT_COUNT
+#define ESP8266_RATE_LIMIT_CLIENT_COUNT 8   // client IPs tracked by token buckets, least recently seen is replaced
+#endif
+
+#ifndef ESP8266_RESERVED_UDP_LINK_COUNT
+#define ESP8266_RESERVED_UDP_LINK_COUNT 0   // link ids reserved from the top for UDP, e.g. 1 -> id 4
+#endif
 
 typedef enum ESP8266ServerStatus {
     ESP8266_SERVER_SUCCESS,
@@ -16,6 +41,54 @@ typedef enum ESP8266ServerStatus {
     ESP8266_SERVER_TIMEOUT
 } ESP8266ServerStatus;
 
+typedef enum ESP8266LinkType {
+    ESP8266_LINK_TCP_SERVER,
+    ESP8266_LINK_UDP,
+    ESP8266_LINK_WEBSOCKET,
+    ESP8266_LINK_STREAMING_BODY
+} ESP8266LinkType;
+
+typedef void (*DatagramHandlerFunction)(ServerContext *context, uint8_t linkId, const char *data, uint32_t length, IPAddress remoteIP, uint16_t remotePort);
+
+typedef struct WebSocketHandlers {
+    void (*onOpen)(ServerContext *context, uint8_t linkId);
+    void (*onMessage)(ServerContext *context, uint8_t linkId, WebSocketOpcode opcode, bool isFinal, const char *data, uint32_t length);   // fragments after first one have CONTINUATION opcode
+    void (*onClose)(ServerContext *context, uint8_t linkId);
+} WebSocketHandlers;
+
+typedef enum RequestBodyAbortReason {
+    REQUEST_BODY_ABORT_DISCONNECTED,    // client closed connection or module restarted
+    REQUEST_BODY_ABORT_TIMEOUT,         // segment was not received in serverTimeoutMs, connection is closed
+    REQUEST_BODY_ABORT_OVERFLOW,        // rx buffer overflow dropped body bytes, connection is closed
+    REQUEST_BODY_ABORT_INVALID          // malformed chunk framing, 400 is sent after callback
+} RequestBodyAbortReason;
+
+typedef struct RequestBodyConsumer {
+    void (*onBegin)(ServerContext *context, HTTPParser *request);    // optional, request and path variables are valid only here
+    void (*onData)(ServerContext *context, uint8_t linkId, const char *data, uint32_t length);
+    RequestHandlerFunction onComplete;  // send response here, request->headers are empty. Not called when upload is aborted
+    void (*onAbort)(ServerContext *context, uint8_t linkId, RequestBodyAbortReason reason);  // optional, discard received data
+} RequestBodyConsumer;
+
+typedef struct ESP8266Link {
+    ESP8266LinkType type;
+    DatagramHandlerFunction datagramHandler;
+    const WebSocketHandlers *webSocketHandlers;
+    const RequestBodyConsumer *bodyConsumer;
+    RequestBodyDecoder bodyDecoder;
+    uint32_t pendingReceiveLength;  // passive receive mode, bytes held by module
+} ESP8266Link;
+
+typedef struct ESP8266LinkHealth {
+    bool isConnected;
+    uint32_t disconnectedAtMs;  // valid while disconnected
+    uint32_t lastOutageMs;
+    uint32_t totalOutageMs;
+    uint16_t reconnectCount;
+    uint16_t serverRestoreCount;    // CIPMUX and CIPSERVER re-run after module reset
+    char bssid[ESP8266_BSSID_LENGTH + 1];   // cached after join, used for fast reconnect
+} ESP8266LinkHealth;
+
 typedef struct ServerIPConfig {
     IPAddress localIP;
     MACAddress localMAC;
@@ -27,7 +100,58 @@ ServerIPConfig startServerESP8266(ServerContext *context, char *ssid, char *pass
 ESP8266ServerStatus startSoftApESP8266(ServerContext *context, char *ssid, char *password, uint16_t channelId, uint8_t encryption);
 ESP8266ServerStatus startMulticastDnsESP8266(ServerContext *context, char *host, char *serverName, uint16_t port);
 
-void processServerRequestsESP8266(ServerContext *context);
+// Exact and "{name:int}" path variable routes, resolved before regex mappings added with addUrlMapping()
+bool addRouteMappingESP8266(ServerContext *context, const char *pathPattern, HTTPMethod method, RequestHandlerFunction handler);
+bool addPriorityRouteMappingESP8266(ServerContext *context, const char *pathPattern, HTTPMethod method, RequestHandlerFunction handler, RoutePriority priority);  // pending requests are served by priority, in order per link
+const PathVariable *getPathVariableESP8266(const char *name);   // valid inside route handler only
+
+// Requests over backlog limit or client IP rate get "503 Retry-After" without calling handler, 0 disables the limit
+void setAdmissionControlESP8266(uint8_t backlogLimit, uint8_t requestsPerSecond, uint8_t burstSize);
+void setAdmissionCloseOnOverloadESP8266(bool isEnabled);    // over backlog limit link is closed without response, saves CIPSEND
+
+// Lazy mode indexes request in single pass. GET, POST and PUT route table requests skip HTTP parser: request->method is set,
+// request->headers, queryParameters and uriPath are empty. Regex mappings get fully parsed request. Getters work in both modes
+void setLazyRequestParsingESP8266(bool isEnabled);
+bool getRequestHeaderESP8266(const char *name, char *valueBuffer, uint32_t bufferSize);
+bool getQueryParameterESP8266(const char *name, char *valueBuffer, uint32_t bufferSize);
+void loadRequestParametersESP8266(HTTPParser *request);   // run full HTTP parser for current request in lazy mode
+
+// Module keeps TCP data until it is pulled with AT+CIPRECVDATA, call after startServerESP8266(), pending requests are kept. Requires AT firmware 1.7+
+// Request header must fit rxDataBufferSize minus pull response reserve, larger one gets 413 and link is closed
+ESP8266ServerStatus enablePassiveReceiveModeESP8266(ServerContext *context);
+
+void processServerRequestsESP8266(ServerContext *context);    // also supervises Wi-Fi link and reconnects when lost
+const ESP8266LinkHealth *getLinkHealthESP8266();
+
+// Tickless idle, sleeps until USART interrupt or next server deadline. Call after processServerRequestsESP8266()
+uint32_t getNextDeadlineESP8266(ServerContext *context);    // milliseconds, 0 when received data is not processed yet
+void idleServerESP8266(ServerContext *context);
+void sleepUntilEventESP8266(uint32_t timeoutMs);    // weak, called with interrupts masked. Default is WFI with one-shot SysTick
 void sendServerResponseESP8266(ServerContext *context, HTTPStatus status, HashMap headers, const char *body);
 
+// Streamed response packed into full CIPSEND segments. Negative content length selects chunked transfer encoding.
+// Datagram, WebSocket and AT command calls between begin and end send buffered response part first as shorter segment
+ESP8266ServerStatus beginResponseStreamESP8266(ServerContext *context, HTTPStatus status, HashMap headers, int32_t contentLength);
+ESP8266ServerStatus writeResponseStreamESP8266(ServerContext *context, const char *data, uint32_t length);
+ESP8266ServerStatus endResponseStreamESP8266(ServerContext *context);
+
+// Streams static template slices from flash and slot values indexed by generated <NAME>_SLOT_* enum, values are not escaped
+ESP8266ServerStatus sendTemplateResponseESP8266(ServerContext *context, HTTPStatus status, HashMap headers, const HTMLTemplate *htmlTemplate, const char *const *slotValues);
+
+// UDP links share +IPD receive with HTTP server. Use remote IP "0.0.0.0" and port 0 for listen only link. Pending requests are kept
+ESP8266ServerStatus openUdpLinkESP8266(ServerContext *context, uint8_t linkId, const char *remoteIP, uint16_t remotePort, uint16_t localPort, DatagramHandlerFunction handler);
+ESP8266ServerStatus sendDatagramESP8266(ServerContext *context, uint8_t linkId, const char *data, uint32_t length);
+ESP8266ServerStatus closeUdpLinkESP8266(ServerContext *context, uint8_t linkId);
+
+// Body is passed to consumer in fragments as they arrive, Content-Length and chunked request encoding supported
+bool addRequestBodyMappingESP8266(ServerContext *context, const char *pathPattern, HTTPMethod method, const RequestBodyConsumer *consumer);
+
+// Each client frame must fit in one TCP segment, ping and close frames are answered automatically
+bool addWebSocketMappingESP8266(ServerContext *context, const char *pathPattern, const WebSocketHandlers *handlers);
+ESP8266ServerStatus sendWebSocketFrameESP8266(ServerContext *context, uint8_t linkId, WebSocketOpcode opcode, const char *data, uint32_t length);
+uint8_t broadcastWebSocketFrameESP8266(ServerContext *context, WebSocketOpcode opcode, const char *data, uint32_t length);
+
+// Binary dump of trace ring, decode with tools/decode_trace.py. Returns false when ESP8266_TRACE_ENABLED is 0
+bool addTraceRouteESP8266(ServerContext *context, const char *path);
+
 void deleteServerESP8266(ServerContext *context);
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "main.h"
+
+#ifndef ESP8266_TRACE_ENABLED
+#define ESP8266_TRACE_ENABLED 0   // compile with ESP8266_TRACE_ENABLED=1 to record events
+#endif
+
+#ifndef ESP8266_TRACE_EVENT_COUNT
+#define ESP8266_TRACE_EVENT_COUNT 256    // must be power of two, 8 bytes per event
+#endif
+
+#define ESP8266_TRACE_MAGIC 0x43525445  // "ETRC", little endian
+#define ESP8266_TRACE_VERSION 1
+#define ESP8266_TRACE_NO_LINK 0xFF
+
+typedef enum TraceEventType {
+    TRACE_AT_COMMAND = 1,       // value: command length
+    TRACE_AT_RESPONSE,          // value: ESP8266ServerStatus
+    TRACE_CIPSEND,              // value: data length
+    TRACE_SEND_PROMPT,          // value: ESP8266ServerStatus, ">" received
+    TRACE_SEND_OK,              // value: data length
+    TRACE_SEND_FAIL,            // value: ESP8266ServerStatus
+    TRACE_IPD_START,            // value: +IPD length
+    TRACE_IPD_END,              // value: +IPD length
+    TRACE_USART_ERROR,          // value: TraceUsartError
+    TRACE_RX_BUFFER_OVERFLOW,   // value: buffer size
+    TRACE_RX_BUFFER_RELEASE,    // value: released length
+    TRACE_HANDLER_ENTER,        // value: ESP8266LinkType
+    TRACE_HANDLER_EXIT,         // value: ESP8266LinkType
+    TRACE_REQUEST_REJECTED      // value: pending request count
+} TraceEventType;
+
+typedef enum TraceUsartError {
+    TRACE_USART_OVERRUN = 1,
+    TRACE_USART_FRAMING,
+    TRACE_USART_NOISE,
+    TRACE_USART_PARITY
+} TraceUsartError;
+
+typedef struct TraceEvent {
+    uint32_t timestamp;     // DWT cycle counter
+    uint8_t type;
+    uint8_t linkId;
+    uint16_t value;
+} TraceEvent;
+
+typedef struct TraceRing {  // dumped as is, same layout from debug route or debugger memory read
+    uint32_t magic;
+    uint16_t version;
+    uint16_t eventCount;
+    uint32_t coreClockHz;
+    volatile uint32_t head;     // total recorded events, oldest is overwritten
+    TraceEvent events[ESP8266_TRACE_EVENT_COUNT];
+} TraceRing;
+
+#if ESP8266_TRACE_ENABLED
+
+extern TraceRing traceRing;
+extern volatile bool isTracePaused;     // set while ring is dumped
+
+void initTraceESP8266();
+
+static inline void recordTraceEvent(uint8_t type, uint8_t linkId, uint16_t value) {   // also called from USART interrupt
+    if (isTracePaused) return;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TraceEvent *event = &traceRing.events[traceRing.head++ & (ESP8266_TRACE_EVENT_COUNT - 1)];
+    event->timestamp = DWT->CYCCNT;
+    event->type = type;
+    event->linkId = linkId;
+    event->value = value;
+    __set_PRIMASK(primask);
+}
+
+static inline void recordTraceEventOnce(uint8_t type, uint8_t linkId, uint16_t value) { // skipped when same as the last event
+    const TraceEvent *lastEvent = &traceRing.events[(traceRing.head - 1) & (ESP8266_TRACE_EVENT_COUNT - 1)];
+    if (traceRing.head > 0 && lastEvent->type == type && lastEvent->linkId == linkId && lastEvent->value == value) return;
+    recordTraceEvent(type, linkId, value);
+}
+
+#define TRACE_INIT() initTraceESP8266()
+#define TRACE_EVENT(type, linkId, value) recordTraceEvent((type), (linkId), (uint16_t) (value))
+#define TRACE_EVENT_ONCE(type, linkId, value) recordTraceEventOnce((type), (linkId), (uint16_t) (value))
+
+#else
+
+#define TRACE_INIT() ((void) 0)
+#define TRACE_EVENT(type, linkId, value) ((void) 0)
+#define TRACE_EVENT_ONCE(type, linkId, value) ((void) 0)
+
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Generated by add_html_templates() from cmake/HTMLTemplate.cmake, "{{name}}" and fixed width "{{name:width}}" placeholders
+typedef struct TemplateSegment {
+    const char *text;   // static slice kept in flash, NULL for value slot
+    uint16_t length;    // slice length or fixed slot width, 0 for variable width slot
+    uint8_t slotIndex;
+} TemplateSegment;
+
+typedef struct HTMLTemplate {
+    const TemplateSegment *segments;
+    uint16_t segmentCount;
+    uint8_t slotCount;
+    bool isFixedLength;     // all slots have width, Content-Length is known before rendering
+    uint32_t fixedLength;
+} HTMLTemplate;
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+typedef enum ResponseStatusFlag {
+    RESPONSE_STATUS_NONE = 0x00,
+    RESPONSE_STATUS_OK = 0x01,
+    RESPONSE_STATUS_CLOSED = 0x02,
+    RESPONSE_STATUS_READY = 0x04,   // ">" prompt for data
+    RESPONSE_STATUS_SEND_OK = 0x08,
+    RESPONSE_STATUS_ERROR = 0x10,
+    RESPONSE_STATUS_FAIL = 0x20,
+    RESPONSE_STATUS_SEND_FAIL = 0x40
+} ResponseStatusFlag;
+
+#define RESPONSE_STATUS_SUCCESS_MASK (RESPONSE_STATUS_OK | RESPONSE_STATUS_CLOSED | RESPONSE_STATUS_READY)
+#define RESPONSE_STATUS_FAILURE_MASK (RESPONSE_STATUS_ERROR | RESPONSE_STATUS_FAIL | RESPONSE_STATUS_SEND_FAIL)
+
+// Word at a time scanning over null terminated receive buffer, 4 bytes are tested per step
+const char *findByteSWAR(const char *data, char value);
+const char *findMarkerSWAR(const char *data, const char *marker);
+
+ResponseStatusFlag classifyResponseLine(const char *line, uint32_t length);   // line without CR LF
+
+// Incremental matcher, all status lines in one pass. Only bytes received since previous feed are inspected, words without LF are skipped
+typedef struct ResponseMatcher {
+    const char *position;   // next byte to inspect
+    const char *lineStart;
+    uint8_t status;     // ResponseStatusFlag bits of all completed lines
+} ResponseMatcher;
+
+void resetResponseMatcher(ResponseMatcher *matcher, const char *data);
+uint8_t feedResponseMatcher(ResponseMatcher *matcher, const char *dataEnd);  // inspects bytes up to dataEnd, returns accumulated status
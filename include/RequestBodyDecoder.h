@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum RequestBodyState {
+    REQUEST_BODY_CONTENT,
+    REQUEST_BODY_CHUNK_SIZE,
+    REQUEST_BODY_CHUNK_EXTENSION,
+    REQUEST_BODY_CHUNK_SIZE_END,
+    REQUEST_BODY_CHUNK_DATA,
+    REQUEST_BODY_CHUNK_DATA_CR,
+    REQUEST_BODY_CHUNK_DATA_LF,
+    REQUEST_BODY_TRAILER_LINE_START,
+    REQUEST_BODY_TRAILER_LINE,
+    REQUEST_BODY_TRAILER_END,
+    REQUEST_BODY_COMPLETE,
+    REQUEST_BODY_INVALID
+} RequestBodyState;
+
+typedef struct RequestBodyDecoder {
+    RequestBodyState state;
+    uint32_t remainingLength;   // content or current chunk bytes left
+    uint8_t sizeDigitCount;
+} RequestBodyDecoder;
+
+void initContentLengthDecoder(RequestBodyDecoder *decoder, uint32_t contentLength);
+void initChunkedDecoder(RequestBodyDecoder *decoder);
+
+// Returns consumed input length, stops after each body span so caller can pass it on without copying
+uint32_t decodeRequestBody(RequestBodyDecoder *decoder, const char *data, uint32_t length, const char **body, uint32_t *bodyLength);
+
+static inline bool isRequestBodyFinished(const RequestBodyDecoder *decoder) {
+    return decoder->state == REQUEST_BODY_COMPLETE || decoder->state == REQUEST_BODY_INVALID;
+}
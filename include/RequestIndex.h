@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define REQUEST_INDEX_MAX_HEADERS 16
+
+typedef struct RequestSpan {
+    uint16_t offset;    // from the request start
+    uint16_t length;
+} RequestSpan;
+
+typedef struct RequestHeaderSpan {
+    RequestSpan name;
+    RequestSpan value;
+} RequestHeaderSpan;
+
+typedef struct RequestIndex {
+    const char *request;    // points into receive buffer, valid until request is consumed
+    RequestSpan method;
+    RequestSpan path;
+    RequestSpan query;  // without leading '?'
+    RequestSpan version;
+    RequestHeaderSpan headers[REQUEST_INDEX_MAX_HEADERS];
+    uint8_t headerCount;
+    uint16_t headerBlockLength;   // request line and headers including empty line
+    bool isValid;
+} RequestIndex;
+
+bool indexHttpRequest(RequestIndex *index, const char *request);
+
+const char *requestIndexFindHeader(const RequestIndex *index, const char *name, uint16_t *length);  // case insensitive, value is not null terminated
+bool requestIndexIsHeaderEquals(const RequestIndex *index, const char *name, const char *value);    // case insensitive
+bool requestIndexCopyHeader(const RequestIndex *index, const char *name, char *valueBuffer, uint32_t bufferSize);
+bool requestIndexCopyQueryParameter(const RequestIndex *index, const char *name, char *valueBuffer, uint32_t bufferSize);   // percent decoded
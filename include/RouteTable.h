@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "HTTPServer.h"
+
+#define ROUTE_TABLE_BUCKET_COUNT 16    // exact route hash buckets, must be power of two
+#define ROUTE_MAX_PATH_VARIABLES 4
+#define ROUTE_PATH_VALUES_BUFFER_SIZE 64
+
+typedef enum PathVariableType {
+    PATH_VARIABLE_STRING,
+    PATH_VARIABLE_INT
+} PathVariableType;
+
+typedef struct PathVariable {
+    const char *name;
+    const char *value;  // null terminated copy of the captured path segment
+    int32_t intValue;   // parsed value for "{name:int}" variables
+    uint16_t length;
+    PathVariableType type;
+} PathVariable;
+
+typedef enum RoutePriority {
+    ROUTE_PRIORITY_BULK,    // large downloads, served after other pending requests
+    ROUTE_PRIORITY_NORMAL,
+    ROUTE_PRIORITY_CONTROL  // served first and never rejected by admission control
+} RoutePriority;
+
+typedef struct RouteEntry {
+    HTTPMethod method;
+    RequestHandlerFunction handler;
+    RoutePriority priority;
+    const void *attachment;   // route specific callbacks, e.g. websocket handlers
+    struct RouteEntry *next;
+} RouteEntry;
+
+typedef struct RouteMatch {
+    const RouteEntry *route;
+    uint8_t variableCount;
+    PathVariable variables[ROUTE_MAX_PATH_VARIABLES];
+    char valuesBuffer[ROUTE_PATH_VALUES_BUFFER_SIZE];
+} RouteMatch;
+
+typedef struct ExactRoute ExactRoute;
+typedef struct RouteNode RouteNode;
+
+typedef struct RouteTable {
+    ExactRoute *buckets[ROUTE_TABLE_BUCKET_COUNT];
+    RouteNode *root;    // prefix trie for patterns with path variables
+} RouteTable;
+
+RouteTable *getRouteTableInstance();
+
+// Pattern examples: "/", "/api/status", "/api/{id:int}/test", "/files/{name}" or "/files/{name:str}"
+// Single trailing slash is ignored for all routes and request paths: "/api/status/" matches "/api/status"
+RouteEntry *routeTableAdd(RouteTable *table, const char *pathPattern, HTTPMethod method, RequestHandlerFunction handler);
+bool routeTableFind(RouteTable *table, HTTPMethod method, const char *path, RouteMatch *match);  // path ends at '\0', '?' or ' '
+
+const PathVariable *routeMatchGetVariable(const RouteMatch *match, const char *name);
+
+void routeTableDelete(RouteTable *table);
@@ -20,7 +20,9 @@ void interruptCallbackUSART6();
 
 void sendByteUSART(USART *USARTPointer, uint8_t byte);
 void sendStringUSART(USART *USARTPointer, const char *string);
-void sendFormattedStringUSART(USART *USARTPointer, uint16_t bufferLength, char *format, ...);
+void sendDataUSART(USART *USARTPointer, const char *data, uint32_t length);
+// Deprecated: formats into stack buffer of bufferLength bytes. Format into own buffer and send with sendDataUSART(), AT commands with ATCommand builder
+void sendFormattedStringUSART(USART *USARTPointer, uint16_t bufferLength, char *format, ...) __attribute__((deprecated("use sendDataUSART() or ATCommand builder")));
 
 uint8_t readByteUSART(USART *USARTPointer);
 void readStringUSART(USART *USARTPointer, char *charArray);
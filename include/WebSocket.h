@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WEBSOCKET_ACCEPT_KEY_LENGTH 28  // base64 of 20 byte SHA-1 digest
+#define WEBSOCKET_MAX_CLIENT_KEY_LENGTH 64
+#define WEBSOCKET_MAX_SERVER_HEADER_LENGTH 4    // server frames are unmasked and shorter than 64KB
+
+typedef enum WebSocketOpcode {
+    WEBSOCKET_OPCODE_CONTINUATION = 0x0,
+    WEBSOCKET_OPCODE_TEXT = 0x1,
+    WEBSOCKET_OPCODE_BINARY = 0x2,
+    WEBSOCKET_OPCODE_CLOSE = 0x8,
+    WEBSOCKET_OPCODE_PING = 0x9,
+    WEBSOCKET_OPCODE_PONG = 0xA
+} WebSocketOpcode;
+
+typedef enum WebSocketFrameStatus {
+    WEBSOCKET_FRAME_OK,
+    WEBSOCKET_FRAME_INCOMPLETE,
+    WEBSOCKET_FRAME_INVALID
+} WebSocketFrameStatus;
+
+typedef struct WebSocketFrame {
+    WebSocketOpcode opcode;
+    bool isFinal;
+    char *payload;  // unmasked in place
+    uint32_t payloadLength;
+    uint32_t frameLength;   // header and payload
+} WebSocketFrame;
+
+bool createWebSocketAcceptKey(const char *clientKey, uint16_t keyLength, char *acceptKey);  // acceptKey buffer at least WEBSOCKET_ACCEPT_KEY_LENGTH + 1
+WebSocketFrameStatus parseWebSocketFrame(char *data, uint32_t length, WebSocketFrame *frame);
+uint8_t formatWebSocketFrameHeader(char *buffer, WebSocketOpcode opcode, uint32_t payloadLength);
@@ -0,0 +1,197 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <string.h>
+
+#include "MarkerScanner.h"
+
+#ifndef CAPTURE_FILE
+#define CAPTURE_FILE "captured_traffic.txt"
+#endif
+
+#define ARRIVAL_STEP 16     // bytes received between two polls of command response
+#define ITERATION_COUNT 20000
+#define MAX_WINDOW_COUNT 128
+
+// Previous readCommandResponse() status checks, six full scans per poll
+#define OK_STATUS             "\r\nOK\r\n"
+#define CLOSED_STATUS         "CLOSED\r\n"
+#define READY_TO_RECEIVE_DATA ">"
+#define ERROR_STATUS          "\r\nERROR\r\n"
+#define FAIL_STATUS           "\r\nFAIL\r\n"
+#define SEND_FAIL_STATUS      "\r\nSEND FAIL\r\n"
+
+typedef struct ResponseWindow {     // from AT command echo to the next one
+    char *data;
+    uint32_t length;
+} ResponseWindow;
+
+#if NAIVE_STRSTR
+#define strstr naiveStrstr          // byte-wise search like newlib built for size on Cortex-M
+
+static char *naiveStrstr(const char *haystack, const char *needle) {
+    for (; *haystack != '\0'; haystack++) {
+        const char *h = haystack;
+        const char *n = needle;
+        while (*n != '\0' && *h == *n) {
+            h++;
+            n++;
+        }
+        if (*n == '\0') return (char *) haystack;
+    }
+    return NULL;
+}
+#endif
+
+static volatile uint32_t sink = 0;  // keeps results alive
+
+static char *loadCapture(const char *path, uint32_t *length);
+static uint32_t splitResponseWindows(char *capture, uint32_t length, ResponseWindow *windows);
+static double elapsedNs(const struct timespec *start);
+
+static inline bool isResponseOK(char *responseBody) {
+    return strstr(responseBody, OK_STATUS) ||
+           strstr(responseBody, CLOSED_STATUS) ||
+           strstr(responseBody, READY_TO_RECEIVE_DATA);
+}
+
+static inline bool isResponseError(char *responseBody) {
+    return strstr(responseBody, ERROR_STATUS) ||
+           strstr(responseBody, FAIL_STATUS) ||
+           strstr(responseBody, SEND_FAIL_STATUS);
+}
+
+static uint32_t pollWithStrstr(ResponseWindow *window) {    // returns polls until terminal status
+    uint32_t pollCount = 0;
+    for (uint32_t received = ARRIVAL_STEP; ; received += ARRIVAL_STEP) {
+        if (received > window->length) received = window->length;
+        char saved = window->data[received];
+        window->data[received] = '\0';
+        bool isFinished = isResponseOK(window->data) || isResponseError(window->data);
+        window->data[received] = saved;
+        pollCount++;
+        if (isFinished || received == window->length) return pollCount;
+    }
+}
+
+static uint32_t pollWithMatcher(ResponseWindow *window) {
+    ResponseMatcher matcher;
+    resetResponseMatcher(&matcher, window->data);
+    uint32_t pollCount = 0;
+    for (uint32_t received = ARRIVAL_STEP; ; received += ARRIVAL_STEP) {
+        if (received > window->length) received = window->length;
+        uint8_t status = feedResponseMatcher(&matcher, window->data + received);
+        pollCount++;
+        if ((status & (RESPONSE_STATUS_SUCCESS_MASK | RESPONSE_STATUS_FAILURE_MASK)) != 0 || received == window->length) return pollCount;
+    }
+}
+
+static uint32_t countMarkersWithStrstr(const char *data, const char *marker) {
+    uint32_t count = 0;
+    for (const char *found = strstr(data, marker); found != NULL; found = strstr(found + 1, marker)) {
+        count++;
+    }
+    return count;
+}
+
+static uint32_t countMarkersWithSWAR(const char *data, const char *marker) {
+    uint32_t count = 0;
+    for (const char *found = findMarkerSWAR(data, marker); found != NULL; found = findMarkerSWAR(found + 1, marker)) {
+        count++;
+    }
+    return count;
+}
+
+int main(int argc, char **argv) {
+    uint32_t captureLength;
+    char *capture = loadCapture(argc > 1 ? argv[1] : CAPTURE_FILE, &captureLength);
+    if (capture == NULL) return 1;
+
+    ResponseWindow windows[MAX_WINDOW_COUNT];
+    uint32_t windowCount = splitResponseWindows(capture, captureLength, windows);
+    uint32_t strstrPolls = 0;
+    uint32_t matcherPolls = 0;
+    for (uint32_t i = 0; i < windowCount; i++) {
+        strstrPolls += pollWithStrstr(&windows[i]);
+        matcherPolls += pollWithMatcher(&windows[i]);
+    }
+    printf("capture: %u bytes, %u command responses, polls strstr %u / matcher %u\n", captureLength, windowCount, strstrPolls, matcherPolls);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t n = 0; n < ITERATION_COUNT; n++) {
+        for (uint32_t i = 0; i < windowCount; i++) sink += pollWithStrstr(&windows[i]);
+    }
+    double strstrNs = elapsedNs(&start) / ITERATION_COUNT;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t n = 0; n < ITERATION_COUNT; n++) {
+        for (uint32_t i = 0; i < windowCount; i++) sink += pollWithMatcher(&windows[i]);
+    }
+    double matcherNs = elapsedNs(&start) / ITERATION_COUNT;
+    printf("command response polling: strstr %.0f ns, ResponseMatcher %.0f ns, x%.1f\n", strstrNs, matcherNs, strstrNs / matcherNs);
+
+    const char *markers[] = {"+IPD,", "\r\n\r\n", ",CLOSED\r\n"};
+    for (uint8_t m = 0; m < sizeof(markers) / sizeof(markers[0]); m++) {
+        uint32_t expected = countMarkersWithStrstr(capture, markers[m]);
+        uint32_t found = countMarkersWithSWAR(capture, markers[m]);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (uint32_t n = 0; n < ITERATION_COUNT; n++) sink += countMarkersWithStrstr(capture, markers[m]);
+        strstrNs = elapsedNs(&start) / ITERATION_COUNT;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (uint32_t n = 0; n < ITERATION_COUNT; n++) sink += countMarkersWithSWAR(capture, markers[m]);
+        double swarNs = elapsedNs(&start) / ITERATION_COUNT;
+        printf("marker %-12s %2u/%2u found: strstr %.0f ns, findMarkerSWAR %.0f ns, x%.1f\n",
+               markers[m][0] == '\r' ? "CRLF CRLF" : (markers[m][0] == ',' ? "<id>,CLOSED" : markers[m]),
+               found, expected, strstrNs, swarNs, strstrNs / swarNs);
+        if (found != expected) return 1;
+    }
+    free(capture);
+    return 0;
+}
+
+static char *loadCapture(const char *path, uint32_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *capture = calloc(1, size + 1);
+    if (capture != NULL && fread(capture, 1, size, file) != (size_t) size) {
+        free(capture);
+        capture = NULL;
+    }
+    fclose(file);
+    *length = (uint32_t) size;
+    return capture;
+}
+
+static uint32_t splitResponseWindows(char *capture, uint32_t length, ResponseWindow *windows) {
+    uint32_t count = 0;
+    char *windowStart = NULL;
+    for (uint32_t i = 0; i + 2 < length; i++) {
+        bool isCommandStart = (i == 0 || capture[i - 1] == '\n' || capture[i - 1] == ' ') && strncmp(&capture[i], "AT", 2) == 0;
+        if (!isCommandStart) continue;
+        if (windowStart != NULL && count < MAX_WINDOW_COUNT) {
+            windows[count++] = (ResponseWindow) {windowStart, (uint32_t) (&capture[i] - windowStart)};
+        }
+        windowStart = &capture[i];
+    }
+    if (windowStart != NULL && count < MAX_WINDOW_COUNT) {
+        windows[count++] = (ResponseWindow) {windowStart, (uint32_t) (&capture[length] - windowStart)};
+    }
+    return count;
+}
+
+static double elapsedNs(const struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (double) (end.tv_sec - start->tv_sec) * 1e9 + (double) (end.tv_nsec - start->tv_nsec);
+}
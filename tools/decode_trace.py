@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Decode ESP8266Server trace ring dump into a timeline.
+
+Dump sources:
+    curl -o trace.bin http://<server>/debug/trace
+    (gdb) dump binary value trace.bin traceRing
+"""
+import struct
+import sys
+
+HEADER_FORMAT = '<IHHII'    # magic, version, eventCount, coreClockHz, head
+EVENT_FORMAT = '<IBBH'      # timestamp, type, linkId, value
+TRACE_MAGIC = 0x43525445
+NO_LINK = 0xFF
+
+EVENT_NAMES = {
+    1: 'AT_COMMAND',
+    2: 'AT_RESPONSE',
+    3: 'CIPSEND',
+    4: 'SEND_PROMPT',
+    5: 'SEND_OK',
+    6: 'SEND_FAIL',
+    7: 'IPD_START',
+    8: 'IPD_END',
+    9: 'USART_ERROR',
+    10: 'RX_BUFFER_OVERFLOW',
+    11: 'RX_BUFFER_RELEASE',
+    12: 'HANDLER_ENTER',
+    13: 'HANDLER_EXIT',
+    14: 'REQUEST_REJECTED',
+}
+
+SERVER_STATUS = ['SUCCESS', 'ERROR', 'BUFFER_FULL', 'TIMEOUT']
+USART_ERRORS = {1: 'OVERRUN', 2: 'FRAMING', 3: 'NOISE', 4: 'PARITY'}
+LINK_TYPES = ['TCP_SERVER', 'UDP', 'WEBSOCKET', 'STREAMING_BODY']
+STATUS_EVENTS = {'AT_RESPONSE', 'SEND_PROMPT', 'SEND_FAIL'}
+LENGTH_EVENTS = {'AT_COMMAND', 'CIPSEND', 'SEND_OK', 'IPD_START', 'IPD_END', 'RX_BUFFER_OVERFLOW', 'RX_BUFFER_RELEASE'}
+
+
+def describe_value(name, value):
+    if name in STATUS_EVENTS:
+        return SERVER_STATUS[value] if value < len(SERVER_STATUS) else str(value)
+    if name == 'USART_ERROR':
+        return USART_ERRORS.get(value, str(value))
+    if name in ('HANDLER_ENTER', 'HANDLER_EXIT'):
+        return LINK_TYPES[value] if value < len(LINK_TYPES) else str(value)
+    if name == 'REQUEST_REJECTED':
+        return '%d pending' % value
+    if name in LENGTH_EVENTS:
+        return '%d bytes' % value
+    return str(value)
+
+
+def read_events(data):
+    header_size = struct.calcsize(HEADER_FORMAT)
+    magic, version, event_count, core_clock_hz, head = struct.unpack_from(HEADER_FORMAT, data)
+    if magic != TRACE_MAGIC:
+        raise ValueError('not a trace ring dump, magic 0x%08X' % magic)
+    if version != 1:
+        raise ValueError('unsupported trace version %d' % version)
+
+    event_size = struct.calcsize(EVENT_FORMAT)
+    recorded = min(head, event_count)
+    first = head - recorded     # oldest event still in ring
+    events = []
+    for sequence in range(first, head):
+        offset = header_size + (sequence % event_count) * event_size
+        events.append(struct.unpack_from(EVENT_FORMAT, data, offset))
+    return core_clock_hz, head - recorded, events
+
+
+def print_timeline(core_clock_hz, lost_count, events):
+    cycles_per_us = core_clock_hz / 1000000.0 if core_clock_hz else 1.0
+    if lost_count:
+        print('# %d older events overwritten' % lost_count)
+    print('%12s %10s  %-4s %-18s %s' % ('time_ms', 'delta_us', 'link', 'event', 'value'))
+
+    start_cycles = None
+    previous_cycles = None
+    previous_total = 0
+    unwrapped = 0
+    for timestamp, event_type, link_id, value in events:
+        if previous_cycles is not None and timestamp < previous_cycles:
+            unwrapped += 1 << 32    # DWT counter wrapped
+        cycles = unwrapped + timestamp
+        if start_cycles is None:
+            start_cycles = previous_total = cycles
+        delta_us = (cycles - previous_total) / cycles_per_us
+        previous_total = cycles
+        previous_cycles = timestamp
+
+        name = EVENT_NAMES.get(event_type, 'UNKNOWN_%d' % event_type)
+        link = '-' if link_id == NO_LINK else str(link_id)
+        time_ms = (cycles - start_cycles) / cycles_per_us / 1000.0
+        print('%12.3f %10.1f  %-4s %-18s %s' % (time_ms, delta_us, link, name, describe_value(name, value)))
+
+
+def main():
+    if len(sys.argv) != 2:
+        print('usage: decode_trace.py <trace.bin>', file=sys.stderr)
+        return 1
+    with open(sys.argv[1], 'rb') as dump:
+        data = dump.read()
+    print_timeline(*read_events(data))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())